@@ -1,4 +1,5 @@
 #include "cgfxcommon/c_offset_allocator.h"
+#include "cgfxcommon/c_bit_intrinsics.h"
 
 #include "cbase/c_memory.h"
 #include "cbase/c_allocator.h"
@@ -7,57 +8,35 @@ namespace ncore
 {
     namespace ngfx
     {
-        inline u32 lzcnt_nonzero(u32 v)
-        {
-#ifdef _MSC_VER
-            unsigned long retVal;
-            _BitScanReverse(&retVal, v);
-            return 31 - retVal;
-#else
-            return __builtin_clz(v);
-#endif
-        }
-
-        inline u32 tzcnt_nonzero(u32 v)
-        {
-#ifdef _MSC_VER
-            unsigned long retVal;
-            _BitScanForward(&retVal, v);
-            return retVal;
-#else
-            return __builtin_ctz(v);
-#endif
-        }
-
         namespace nfloat
         {
-            static constexpr u32 MANTISSA_BITS  = 3;
-            static constexpr u32 MANTISSA_VALUE = 1 << MANTISSA_BITS;
-            static constexpr u32 MANTISSA_MASK  = MANTISSA_VALUE - 1;
-
             // Bin sizes follow floating point (exponent + mantissa) distribution (piecewise linear log approx)
             // This ensures that for each size class, the average overhead percentage stays the same
-            u32 uintToFloatRoundUp(u32 size)
+            template <u32 MANTISSA_BITS, typename T>
+            inline u32 toFloatRoundUp(T size)
             {
+                constexpr u32 MANTISSA_VALUE = 1 << MANTISSA_BITS;
+                constexpr u32 MANTISSA_MASK  = MANTISSA_VALUE - 1;
+
                 u32 exp      = 0;
                 u32 mantissa = 0;
 
                 if (size < MANTISSA_VALUE)
                 {
                     // Denorm: 0..(MANTISSA_VALUE-1)
-                    mantissa = size;
+                    mantissa = (u32)size;
                 }
                 else
                 {
                     // Normalized: Hidden high bit always 1. Not stored. Just like float.
                     u32 leadingZeros  = lzcnt_nonzero(size);
-                    u32 highestSetBit = 31 - leadingZeros;
+                    u32 highestSetBit = (sizeof(T) * 8 - 1) - leadingZeros;
 
                     u32 mantissaStartBit = highestSetBit - MANTISSA_BITS;
                     exp                  = mantissaStartBit + 1;
-                    mantissa             = (size >> mantissaStartBit) & MANTISSA_MASK;
+                    mantissa             = (u32)(size >> mantissaStartBit) & MANTISSA_MASK;
 
-                    u32 lowBitsMask = (1 << mantissaStartBit) - 1;
+                    T lowBitsMask = ((T)1 << mantissaStartBit) - 1;
 
                     // Round up!
                     if ((size & lowBitsMask) != 0)
@@ -67,495 +46,1505 @@ namespace ncore
                 return (exp << MANTISSA_BITS) + mantissa;  // + allows mantissa->exp overflow for round up
             }
 
-            u32 uintToFloatRoundDown(u32 size)
+            template <u32 MANTISSA_BITS, typename T>
+            inline u32 toFloatRoundDown(T size)
             {
+                constexpr u32 MANTISSA_VALUE = 1 << MANTISSA_BITS;
+                constexpr u32 MANTISSA_MASK  = MANTISSA_VALUE - 1;
+
                 u32 exp      = 0;
                 u32 mantissa = 0;
 
                 if (size < MANTISSA_VALUE)
                 {
                     // Denorm: 0..(MANTISSA_VALUE-1)
-                    mantissa = size;
+                    mantissa = (u32)size;
                 }
                 else
                 {
                     // Normalized: Hidden high bit always 1. Not stored. Just like float.
                     u32 leadingZeros  = lzcnt_nonzero(size);
-                    u32 highestSetBit = 31 - leadingZeros;
+                    u32 highestSetBit = (sizeof(T) * 8 - 1) - leadingZeros;
 
                     u32 mantissaStartBit = highestSetBit - MANTISSA_BITS;
                     exp                  = mantissaStartBit + 1;
-                    mantissa             = (size >> mantissaStartBit) & MANTISSA_MASK;
+                    mantissa             = (u32)(size >> mantissaStartBit) & MANTISSA_MASK;
                 }
 
                 return (exp << MANTISSA_BITS) | mantissa;
             }
 
-            u32 floatToUint(u32 floatValue)
-            {
-                u32 exponent = floatValue >> MANTISSA_BITS;
-                u32 mantissa = floatValue & MANTISSA_MASK;
-                if (exponent == 0)
-                {
-                    // Denorms
-                    return mantissa;
-                }
-                else
-                {
-                    return (mantissa | MANTISSA_VALUE) << (exponent - 1);
-                }
-            }
+            u32 uintToFloatRoundUp(u32 size) { return toFloatRoundUp<3, u32>(size); }
+            u32 uintToFloatRoundDown(u32 size) { return toFloatRoundDown<3, u32>(size); }
+            u32 floatToUint(u32 floatValue) { return noffset::bins_t<u32, 3>::binSize(floatValue); }
         }  // namespace nfloat
 
         // Utility functions
-        u32 findLowestSetBitAfter(u32 bitMask, u32 startBitIndex)
+        static constexpr u32 NO_BIN = 0xffffffff;
+
+        template <typename T>
+        u32 findLowestSetBitAfter(T bitMask, u32 startBitIndex)
         {
-            u32 maskBeforeStartIndex = (1 << startBitIndex) - 1;
-            u32 maskAfterStartIndex  = ~maskBeforeStartIndex;
-            u32 bitsAfter            = bitMask & maskAfterStartIndex;
+            T maskBeforeStartIndex = ((T)1 << startBitIndex) - 1;
+            T maskAfterStartIndex  = ~maskBeforeStartIndex;
+            T bitsAfter            = bitMask & maskAfterStartIndex;
             if (bitsAfter == 0)
-                return allocation_t::NO_SPACE;
+                return NO_BIN;
             return tzcnt_nonzero(bitsAfter);
         }
 
-        // offset_allocator_t...
-        offset_allocator_t::offset_allocator_t(alloc_t* allocator, u32 size, u32 maxAllocs)
-            : m_allocator(allocator)
-            , m_size(size)
-            , m_maxAllocs(maxAllocs)
-            , m_freeStorage(0)
-            , m_usedBinsTop(0)
-            , m_nodes(nullptr)
-            , m_neighbors(nullptr)
-            , m_used(nullptr)
-            , m_freeIndex(0)
-            , m_freeListHead(node_t::NIL)
-            , m_freeOffset(maxAllocs - 1)
-        {
-            ASSERT(m_size < 0x80000000);  // Size must be less than 2^31
-        }
-
-        offset_allocator_t::offset_allocator_t(offset_allocator_t&& other)
-            : m_allocator(other.m_allocator)
-            , m_size(other.m_size)
-            , m_maxAllocs(other.m_maxAllocs)
-            , m_freeStorage(other.m_freeStorage)
-            , m_usedBinsTop(other.m_usedBinsTop)
-            , m_nodes(other.m_nodes)
-            , m_neighbors(other.m_neighbors)
-            , m_used(other.m_used)
-            , m_freeIndex(other.m_freeIndex)
-            , m_freeListHead(other.m_freeListHead)
-            , m_freeOffset(other.m_freeOffset)
+        template <typename T>
+        void siftDownByOffset(noffset::allocation_t<T>* allocations, u32 root, u32 count)
         {
-            nmem::memcpy(m_usedBins, other.m_usedBins, sizeof(u8) * NUM_TOP_BINS);
-            nmem::memcpy(m_binIndices, other.m_binIndices, sizeof(u32) * NUM_LEAF_BINS);
-
-            other.m_allocator    = nullptr;
-            other.m_nodes        = nullptr;
-            other.m_neighbors    = nullptr;
-            other.m_used         = nullptr;
-            other.m_freeIndex    = 0;
-            other.m_freeListHead = node_t::NIL;
-            other.m_freeOffset   = 0;
-            other.m_maxAllocs    = 0;
-            other.m_usedBinsTop  = 0;
+            const noffset::allocation_t<T> item = allocations[root];
+            while (true)
+            {
+                u32 child = (root * 2) + 1;
+                if (child >= count)
+                    break;
+                if ((child + 1) < count && allocations[child + 1].offset > allocations[child].offset)
+                    child++;
+                if (allocations[child].offset <= item.offset)
+                    break;
+                allocations[root] = allocations[child];
+                root              = child;
+            }
+            allocations[root] = item;
         }
 
-        void offset_allocator_t::setup()
+        // Heap sort, allocations ordered by ascending offset
+        template <typename T>
+        void sortAllocationsByOffset(noffset::allocation_t<T>* allocations, u32 count)
         {
-            m_nodes     = (node_t*)m_allocator->allocate(sizeof(node_t) * m_maxAllocs);
-            m_neighbors = (neighbor_t*)m_allocator->allocate(sizeof(neighbor_t) * m_maxAllocs);
-            m_used      = (u32*)m_allocator->allocate((m_maxAllocs >> 5) * sizeof(u32));
-
-            reset();
-        }
+            if (count < 2)
+                return;
 
-        void offset_allocator_t::teardown()
-        {
-            if (m_nodes)
-                m_allocator->deallocate(m_nodes);
-            if (m_neighbors)
-                m_allocator->deallocate(m_neighbors);
-            if (m_used)
-                m_allocator->deallocate(m_used);
-
-            m_freeStorage  = 0;
-            m_usedBinsTop  = 0;
-            m_freeOffset   = m_maxAllocs - 1;
-            m_nodes        = nullptr;
-            m_neighbors    = nullptr;
-            m_used         = nullptr;
-            m_freeIndex    = 0;
-            m_freeListHead = node_t::NIL;
+            for (u32 i = count / 2; i > 0;)
+            {
+                --i;
+                siftDownByOffset(allocations, i, count);
+            }
+            for (u32 end = count - 1; end > 0; --end)
+            {
+                const noffset::allocation_t<T> top = allocations[0];
+                allocations[0]                     = allocations[end];
+                allocations[end]                   = top;
+                siftDownByOffset(allocations, 0, end);
+            }
         }
 
-        void offset_allocator_t::reset()
+        // Bin sizes of each bin layout, generated at compile time
+        template <typename T, u32 MANTISSA_BITS>
+        struct bin_sizes_t
         {
-            m_freeStorage = 0;
-            m_usedBinsTop = 0;
-            m_freeOffset  = m_maxAllocs - 1;
+            typedef noffset::bins_t<T, MANTISSA_BITS> bins;
 
-            for (u32 i = 0; i < NUM_TOP_BINS; i++)
-                m_usedBins[i] = 0;
+            constexpr bin_sizes_t()
+                : m_sizes()
+            {
+                for (u32 i = 0; i < bins::NUM_LEAF_BINS; i++)
+                    m_sizes[i] = bins::binSize(i);
+            }
 
-            for (u32 i = 0; i < NUM_LEAF_BINS; i++)
-                m_binIndices[i] = node_t::NIL;
+            inline T at(u32 binIndex) const { return m_sizes[binIndex]; }
 
-            m_freeIndex    = 0;
-            m_freeListHead = node_t::NIL;
+            T m_sizes[bins::NUM_LEAF_BINS];
+        };
 
-            // Start state: Whole storage as one big node
-            // Algorithm will split remainders and push them back as smaller nodes
-            insertNodeIntoBin(m_size, 0);
-        }
+        template <typename T, u32 MANTISSA_BITS>
+        static constexpr bin_sizes_t<T, MANTISSA_BITS> c_binSizes = bin_sizes_t<T, MANTISSA_BITS>();
 
-        offset_allocator_t::~offset_allocator_t()
+        namespace noffset
         {
-            if (m_nodes)
-                m_allocator->deallocate(m_nodes);
-            if (m_neighbors)
-                m_allocator->deallocate(m_neighbors);
-            if (m_used)
-                m_allocator->deallocate(m_used);
-        }
+            // Snapshot layout: header, usedBins, binIndices, binCounts, binTotals, nodes (each section 8 byte aligned)
+            static constexpr u32 SNAPSHOT_MAGIC   = 0x5346464f;  // 'OFFS'
+            static constexpr u32 SNAPSHOT_VERSION = 1;
 
-        allocation_t offset_allocator_t::allocate(u32 size)
-        {
-            // Out of allocations?
-            if (m_freeOffset == 0)
+            struct snapshot_header_t
             {
-                return {.offset = allocation_t::NO_SPACE, .metadata = allocation_t::NO_SPACE};
+                u32 magic;
+                u32 version;
+                u32 offsetBytes;
+                u32 mantissaBits;
+                u32 maxAllocs;
+                u32 numNodes;
+                u32 freeListHead;
+                u32 freeOffset;
+                u32 freeNodes;
+                u32 nodeBytes;
+                u64 size;
+                u64 freeStorage;
+                u64 usedBinsTop;
+            };
+
+            static inline u64 snapshotAlign(u64 size) { return (size + 7) & ~(u64)7; }
+
+            // allocator_t...
+            template <typename T, u32 MANTISSA_BITS>
+            allocator_t<T, MANTISSA_BITS>::allocator_t(alloc_t* allocator, T size, u32 maxAllocs)
+                : m_allocator(allocator)
+                , m_size(size)
+                , m_maxAllocs(maxAllocs)
+                , m_freeStorage(0)
+                , m_usedBinsTop(0)
+                , m_nodes(nullptr)
+                , m_freeIndex(0)
+                , m_freeListHead(node_t::NIL)
+                , m_freeOffset(maxAllocs - 1)
+                , m_freeNodes(0)
+                , m_cursorNode(node_t::NIL)
+                , m_deferred(nullptr)
+                , m_deferredFrames(nullptr)
+                , m_deferredNodes(nullptr)
+                , m_deferredHead(0)
+                , m_deferredCount(0)
+                , m_deferredCapacity(0)
+                , m_deferredSize(0)
+            {
+                ASSERT(m_size < ((T)1 << (sizeof(T) * 8 - 1)));  // Size must be less than 2^31 (u32) or 2^63 (u64)
             }
 
-            // Round up to bin index to ensure that alloc >= bin
-            // Gives us min bin index that fits the size
-            const u32 minBinIndex = nfloat::uintToFloatRoundUp(size);
-
-            const u32 minTopBinIndex  = minBinIndex >> TOP_BINS_INDEX_SHIFT;
-            const u32 minLeafBinIndex = minBinIndex & LEAF_BINS_INDEX_MASK;
-
-            u32 topBinIndex  = minTopBinIndex;
-            u32 leafBinIndex = allocation_t::NO_SPACE;
-
-            // If top bin exists, scan its leaf bin. This can fail (NO_SPACE).
-            if (m_usedBinsTop & (1 << topBinIndex))
+            template <typename T, u32 MANTISSA_BITS>
+            allocator_t<T, MANTISSA_BITS>::allocator_t(allocator_t&& other)
+                : m_allocator(other.m_allocator)
+                , m_size(other.m_size)
+                , m_maxAllocs(other.m_maxAllocs)
+                , m_freeStorage(other.m_freeStorage)
+                , m_usedBinsTop(other.m_usedBinsTop)
+                , m_nodes(other.m_nodes)
+                , m_freeIndex(other.m_freeIndex)
+                , m_freeListHead(other.m_freeListHead)
+                , m_freeOffset(other.m_freeOffset)
+                , m_freeNodes(other.m_freeNodes)
+                , m_cursorNode(other.m_cursorNode)
+                , m_deferred(other.m_deferred)
+                , m_deferredFrames(other.m_deferredFrames)
+                , m_deferredNodes(other.m_deferredNodes)
+                , m_deferredHead(other.m_deferredHead)
+                , m_deferredCount(other.m_deferredCount)
+                , m_deferredCapacity(other.m_deferredCapacity)
+                , m_deferredSize(other.m_deferredSize)
             {
-                leafBinIndex = findLowestSetBitAfter(m_usedBins[topBinIndex], minLeafBinIndex);
+                nmem::memcpy(m_usedBins, other.m_usedBins, sizeof(m_usedBins));
+                nmem::memcpy(m_binIndices, other.m_binIndices, sizeof(u32) * NUM_LEAF_BINS);
+                nmem::memcpy(m_binCounts, other.m_binCounts, sizeof(m_binCounts));
+                nmem::memcpy(m_binTotals, other.m_binTotals, sizeof(m_binTotals));
+
+                other.m_allocator    = nullptr;
+                other.m_nodes        = nullptr;
+                other.m_freeIndex    = 0;
+                other.m_freeListHead = node_t::NIL;
+                other.m_freeOffset   = 0;
+                other.m_maxAllocs    = 0;
+                other.m_usedBinsTop  = 0;
+
+                other.m_deferred         = nullptr;
+                other.m_deferredFrames   = nullptr;
+                other.m_deferredNodes    = nullptr;
+                other.m_deferredHead     = 0;
+                other.m_deferredCount    = 0;
+                other.m_deferredCapacity = 0;
+                other.m_deferredSize     = 0;
             }
 
-            // If we didn't find space in top bin, we search top bin from +1
-            if (leafBinIndex == allocation_t::NO_SPACE)
+            template <typename T, u32 MANTISSA_BITS>
+            void allocator_t<T, MANTISSA_BITS>::setup()
             {
-                topBinIndex = findLowestSetBitAfter(m_usedBinsTop, minTopBinIndex + 1);
+                m_nodes = (node_t*)m_allocator->allocate(sizeof(node_t) * m_maxAllocs);
 
-                // Out of space?
-                if (topBinIndex == allocation_t::NO_SPACE)
+                reset();
+            }
+
+            template <typename T, u32 MANTISSA_BITS>
+            void allocator_t<T, MANTISSA_BITS>::teardown()
+            {
+                if (m_nodes)
+                    m_allocator->deallocate(m_nodes);
+                if (m_deferred)
                 {
-                    return {.offset = allocation_t::NO_SPACE, .metadata = allocation_t::NO_SPACE};
+                    m_allocator->deallocate(m_deferred);
+                    m_allocator->deallocate(m_deferredFrames);
+                    m_allocator->deallocate(m_deferredNodes);
                 }
 
-                // All leaf bins here fit the alloc, since the top bin was rounded up. Start leaf search from bit 0.
-                // NOTE: This search can't fail since at least one leaf bit was set because the top bit was set.
-                leafBinIndex = tzcnt_nonzero(m_usedBins[topBinIndex]);
+                m_deferred         = nullptr;
+                m_deferredFrames   = nullptr;
+                m_deferredNodes    = nullptr;
+                m_deferredHead     = 0;
+                m_deferredCount    = 0;
+                m_deferredCapacity = 0;
+                m_deferredSize     = 0;
+
+                m_freeStorage  = 0;
+                m_usedBinsTop  = 0;
+                m_freeOffset   = m_maxAllocs - 1;
+                m_nodes        = nullptr;
+                m_freeIndex    = 0;
+                m_freeListHead = node_t::NIL;
             }
 
-            const u32 binIndex = (topBinIndex << TOP_BINS_INDEX_SHIFT) | leafBinIndex;
+            template <typename T, u32 MANTISSA_BITS>
+            void allocator_t<T, MANTISSA_BITS>::reset()
+            {
+                m_freeStorage = 0;
+                m_usedBinsTop = 0;
+                m_freeOffset  = m_maxAllocs - 1;
 
-            // Pop the top node of the bin. Bin top = node.next.
-            const u32   nodeIndex     = m_binIndices[binIndex];
-            node_t&     node          = m_nodes[nodeIndex];
-            neighbor_t& neighbor      = m_neighbors[nodeIndex];
-            const u32   nodeTotalSize = node.dataSize;
-            node.dataSize             = size;
-            setUsed(nodeIndex);
-            m_binIndices[binIndex] = node.binListNext;
-            if (node.binListNext != node_t::NIL)
-                m_nodes[node.binListNext].binListPrev = node_t::NIL;
+                for (u32 i = 0; i < NUM_TOP_BINS; i++)
+                    m_usedBins[i] = 0;
 
-            m_freeStorage -= nodeTotalSize;
-#ifdef DEBUG_VERBOSE
-            printf("Free storage: %u (-%u) (allocate)\n", m_freeStorage, nodeTotalSize);
-#endif
+                for (u32 i = 0; i < NUM_LEAF_BINS; i++)
+                {
+                    m_binIndices[i] = node_t::NIL;
+                    m_binCounts[i]  = 0;
+                    m_binTotals[i]  = 0;
+                }
+                m_freeNodes = 0;
+
+                m_freeIndex    = 0;
+                m_freeListHead = node_t::NIL;
+                m_cursorNode   = node_t::NIL;
+
+                // Deferred frees are dropped together with all other allocations
+                if (m_deferredNodes)
+                    nmem::memset(m_deferredNodes, 0, ((m_maxAllocs + 31) >> 5) * sizeof(u32));
+                m_deferredHead  = 0;
+                m_deferredCount = 0;
+                m_deferredSize  = 0;
+
+                // Start state: Whole storage as one big node
+                // Algorithm will split remainders and push them back as smaller nodes
+                insertNodeIntoBin(m_size, 0);
+            }
 
-            // Bin empty?
-            if (m_binIndices[binIndex] == node_t::NIL)
+            template <typename T, u32 MANTISSA_BITS>
+            bool allocator_t<T, MANTISSA_BITS>::growSize(T additionalSize)
             {
-                m_usedBins[topBinIndex] &= ~(1 << leafBinIndex);  // Remove a leaf bin mask bit
+                ASSERT((m_size + additionalSize) < ((T)1 << (sizeof(T) * 8 - 1)));
+                if (additionalSize == 0)
+                    return true;
+
+                if (!m_nodes)
+                {
+                    m_size += additionalSize;
+                    return true;
+                }
+
+                // Out of allocations? (a used tail needs a new node)
+                if (m_freeOffset == 0)
+                    return false;
 
-                // All leaf bins empty?
-                if (m_usedBins[topBinIndex] == 0)
+                const u32 tailIndex = findTailNode();
+                T         offset    = m_size;
+                T         size      = additionalSize;
+                u32       prevIndex = tailIndex;
+                if (!isUsed(tailIndex))
                 {
-                    m_usedBinsTop &= ~(1 << topBinIndex);  // Remove a top bin mask bit
+                    // Merge with the free tail, the node is removed and a combined node is inserted
+                    offset    = m_nodes[tailIndex].dataOffset;
+                    size      = m_nodes[tailIndex].dataSize + additionalSize;
+                    prevIndex = m_nodes[tailIndex].neighbor.prev;
+                    removeNodeFromBin(tailIndex);
                 }
+
+                const u32 nodeIndex = insertNodeIntoBin(size, offset);
+
+                m_nodes[nodeIndex].neighbor.prev = prevIndex;
+                m_nodes[nodeIndex].neighbor.next = node_t::NIL;
+                if (prevIndex != node_t::NIL)
+                    m_nodes[prevIndex].neighbor.next = nodeIndex;
+
+                m_size += additionalSize;
+                return true;
             }
 
-            // Push back remaining N elements to a lower bin
-            const u32 reminderSize = nodeTotalSize - size;
-            if (reminderSize > 0)
+            template <typename T, u32 MANTISSA_BITS>
+            bool allocator_t<T, MANTISSA_BITS>::growCapacity(u32 maxAllocs)
             {
-                const u32 newNodeIndex = insertNodeIntoBin(reminderSize, node.dataOffset + size);
+                if (maxAllocs <= m_maxAllocs)
+                    return false;
 
-                // Link new node after the current node so that we can merge them later if both are free
-                // And update the old next neighbor to point to the new node (in middle)
-                if (neighbor.next != node_t::NIL)
-                    m_neighbors[neighbor.next].prev = newNodeIndex;
-                m_neighbors[newNodeIndex].prev = nodeIndex;
-                m_neighbors[newNodeIndex].next = neighbor.next;
-                neighbor.next                  = newNodeIndex;
+                if (!m_nodes)
+                {
+                    m_maxAllocs = maxAllocs;
+                    return true;
+                }
+
+                // Node indices are the allocation metadata, so the nodes are copied as-is
+                node_t* nodes = (node_t*)m_allocator->allocate(sizeof(node_t) * maxAllocs);
+                nmem::memcpy(nodes, m_nodes, sizeof(node_t) * m_freeIndex);
+                m_allocator->deallocate(m_nodes);
+                m_nodes = nodes;
+
+                if (m_deferredNodes)
+                {
+                    u32* deferredNodes = (u32*)m_allocator->allocate(((maxAllocs + 31) >> 5) * sizeof(u32));
+                    nmem::memset(deferredNodes, 0, ((maxAllocs + 31) >> 5) * sizeof(u32));
+                    nmem::memcpy(deferredNodes, m_deferredNodes, ((m_maxAllocs + 31) >> 5) * sizeof(u32));
+                    m_allocator->deallocate(m_deferredNodes);
+                    m_deferredNodes = deferredNodes;
+                }
+                m_freeOffset += maxAllocs - m_maxAllocs;
+                m_maxAllocs = maxAllocs;
+                return true;
             }
 
-            return {.offset = node.dataOffset, .metadata = nodeIndex};
-        }
+            template <typename T, u32 MANTISSA_BITS>
+            allocator_t<T, MANTISSA_BITS>::~allocator_t()
+            {
+                if (m_nodes)
+                    m_allocator->deallocate(m_nodes);
+                if (m_deferred)
+                {
+                    m_allocator->deallocate(m_deferred);
+                    m_allocator->deallocate(m_deferredFrames);
+                    m_allocator->deallocate(m_deferredNodes);
+                }
+            }
 
-        void offset_allocator_t::free(allocation_t allocation)
-        {
-            ASSERT(allocation.metadata != allocation_t::NO_SPACE);
-            if (!m_nodes)
-                return;
+            template <typename T, u32 MANTISSA_BITS>
+            allocation_t<T> allocator_t<T, MANTISSA_BITS>::allocate(T size)
+            {
+                // Out of allocations?
+                if (m_freeOffset == 0)
+                {
+                    return {.offset = allocation_t<T>::NO_SPACE, .metadata = allocation_t<T>::NO_SPACE};
+                }
 
-            const u32   nodeIndex = allocation.metadata;
-            node_t&     node      = m_nodes[nodeIndex];
-            neighbor_t& neighbor  = m_neighbors[nodeIndex];
+                const u32 binIndex = findFreeBin(size);
 
-            // Double delete check
-            ASSERT(isUsed(nodeIndex));
+                // Out of space?
+                if (binIndex == NO_BIN)
+                {
+                    return {.offset = allocation_t<T>::NO_SPACE, .metadata = allocation_t<T>::NO_SPACE};
+                }
 
-            // Merge with neighbors...
-            u32 offset = node.dataOffset;
-            u32 size   = node.dataSize;
+                return allocateFromBin(binIndex, size, 1, HINT_NONE);
+            }
 
-            if ((neighbor.prev != node_t::NIL) && (isUsed(neighbor.prev) == false))
+            template <typename T, u32 MANTISSA_BITS>
+            allocation_t<T> allocator_t<T, MANTISSA_BITS>::allocate(T size, T alignment, hint_t hint)
             {
-                // Previous (contiguous) free node: Change offset to previous node offset. Sum sizes
-                node_t&     prevNode     = m_nodes[neighbor.prev];
-                neighbor_t& prevNeighbor = m_neighbors[neighbor.prev];
-                offset                   = prevNode.dataOffset;
-                size += prevNode.dataSize;
+                ASSERT(alignment != 0 && (alignment & (alignment - 1)) == 0);  // Alignment must be a power of 2
+                if (alignment <= 1 && hint == HINT_NONE)
+                    return allocate(size);
+
+                // Out of allocations? An aligned allocation can need two extra nodes, the leading padding and the remainder.
+                if (m_freeOffset < 2)
+                {
+                    return {.offset = allocation_t<T>::NO_SPACE, .metadata = allocation_t<T>::NO_SPACE};
+                }
 
-                // Remove node from the bin linked list and put it in the freelist
-                removeNodeFromBin(neighbor.prev);
+                // Hinted blocks are taken from the largest free block, long-lived from its start and transient from its
+                // end, so both grow toward each other instead of filling the holes that the other one leaves behind.
+                // The head node of the chosen bin may already be aligned, or have enough slack to align it
+                u32 binIndex = (hint == HINT_NONE) ? findFreeBin(size) : findLargestBin();
+                if (binIndex != NO_BIN)
+                {
+                    const node_t& node          = m_nodes[m_binIndices[binIndex]];
+                    const T       alignedOffset = (node.dataOffset + alignment - 1) & ~(alignment - 1);
+                    if (node.dataSize < (alignedOffset - node.dataOffset) + size)
+                    {
+                        // Any node of at least (size + alignment - 1) can hold the allocation at an aligned offset
+                        binIndex = findFreeBin(size + alignment - 1);
+                    }
+                }
+
+                // Out of space?
+                if (binIndex == NO_BIN)
+                {
+                    return {.offset = allocation_t<T>::NO_SPACE, .metadata = allocation_t<T>::NO_SPACE};
+                }
 
-                ASSERT(prevNeighbor.next == nodeIndex);
-                neighbor.prev = prevNeighbor.prev;
+                return allocateFromBin(binIndex, size, alignment, hint);
             }
 
-            if ((neighbor.next != node_t::NIL) && (isUsed(neighbor.next) == false))
+            template <typename T, u32 MANTISSA_BITS>
+            allocation_t<T> allocator_t<T, MANTISSA_BITS>::allocateAt(T offset, T size)
             {
-                // Next (contiguous) free node: Offset remains the same. Sum sizes.
-                neighbor_t& nextNeighbor = m_neighbors[neighbor.next];
-                node_t&     nextNode     = m_nodes[neighbor.next];
-                size += nextNode.dataSize;
+                // Out of space or out of allocations? The leading and trailing free space can cost two extra nodes.
+                if (!m_nodes || m_usedBinsTop == 0 || m_freeOffset < 2 || offset >= m_size || size > (m_size - offset))
+                {
+                    return {.offset = allocation_t<T>::NO_SPACE, .metadata = allocation_t<T>::NO_SPACE};
+                }
 
-                // Remove node from the bin linked list and put it in the freelist
-                removeNodeFromBin(neighbor.next);
+                // Start at the previous claim or otherwise at any free node, then walk the neighbor chain
+                u32 nodeIndex = m_cursorNode;
+                if (nodeIndex == node_t::NIL)
+                {
+                    const u32 topBinIndex  = tzcnt_nonzero(m_usedBinsTop);
+                    const u32 leafBinIndex = tzcnt_nonzero((u32)m_usedBins[topBinIndex]);
+                    nodeIndex              = m_binIndices[(topBinIndex << TOP_BINS_INDEX_SHIFT) | leafBinIndex];
+                }
+                while (m_nodes[nodeIndex].dataOffset > offset)
+                    nodeIndex = m_nodes[nodeIndex].neighbor.prev;
+                while ((m_nodes[nodeIndex].dataOffset + m_nodes[nodeIndex].dataSize) <= offset && m_nodes[nodeIndex].neighbor.next != node_t::NIL)
+                    nodeIndex = m_nodes[nodeIndex].neighbor.next;
+                m_cursorNode = nodeIndex;
+
+                const T nodeOffset = m_nodes[nodeIndex].dataOffset;
+                const T nodeSize   = m_nodes[nodeIndex].dataSize;
+                if (isUsed(nodeIndex) || (offset + size) > (nodeOffset + nodeSize))
+                {
+                    return {.offset = allocation_t<T>::NO_SPACE, .metadata = allocation_t<T>::NO_SPACE};
+                }
 
-                ASSERT(nextNeighbor.prev == nodeIndex);
-                neighbor.next = (nextNeighbor.next);
-            }
+                const u32 nodePrev = m_nodes[nodeIndex].neighbor.prev;
+                const u32 nodeNext = m_nodes[nodeIndex].neighbor.next;
+                removeNodeFromBin(nodeIndex);
 
-            const u32 nodeNext = neighbor.next;
-            const u32 nodePrev = neighbor.prev;
+                // Split into [leading free] [used] [trailing free]
+                const u32 usedNodeIndex = popFreeNode();
+                m_nodes[usedNodeIndex]  = {.dataOffset = offset, .dataSize = size};
+                setUsed(usedNodeIndex);
 
-            // Insert the removed node to freelist
-#ifdef DEBUG_VERBOSE
-            printf("Putting node %u into freelist[%u] (free)\n", nodeIndex, m_freeOffset + 1);
-#endif
-            // m_freeListHead is the head of the freelist. node.binListNext is the next node in the bin.
-            if (m_freeListHead == node_t::NIL)
-            {
-                node.binListPrev = node_t::NIL;
-                node.binListNext = node_t::NIL;
-                m_freeListHead   = nodeIndex;
+                u32 prevIndex = nodePrev;
+                if (offset > nodeOffset)
+                {
+                    const u32 leadNodeIndex              = insertNodeIntoBin(offset - nodeOffset, nodeOffset);
+                    m_nodes[leadNodeIndex].neighbor.prev = nodePrev;
+                    prevIndex                            = leadNodeIndex;
+                    if (nodePrev != node_t::NIL)
+                        m_nodes[nodePrev].neighbor.next = leadNodeIndex;
+                }
+
+                u32 nextIndex = nodeNext;
+                if ((offset + size) < (nodeOffset + nodeSize))
+                {
+                    const u32 trailNodeIndex              = insertNodeIntoBin((nodeOffset + nodeSize) - (offset + size), offset + size);
+                    m_nodes[trailNodeIndex].neighbor.next = nodeNext;
+                    nextIndex                             = trailNodeIndex;
+                    if (nodeNext != node_t::NIL)
+                        m_nodes[nodeNext].neighbor.prev = trailNodeIndex;
+                }
+
+                // Relink: prev <-> used <-> next
+                if (prevIndex != node_t::NIL)
+                    m_nodes[prevIndex].neighbor.next = usedNodeIndex;
+                if (nextIndex != node_t::NIL)
+                    m_nodes[nextIndex].neighbor.prev = usedNodeIndex;
+                m_nodes[usedNodeIndex].neighbor.prev = prevIndex;
+                m_nodes[usedNodeIndex].neighbor.next = nextIndex;
+
+                // The next claim most likely follows this one
+                m_cursorNode = nextIndex != node_t::NIL ? nextIndex : usedNodeIndex;
+
+                return {.offset = offset, .metadata = usedNodeIndex};
             }
-            else
+
+            template <typename T, u32 MANTISSA_BITS>
+            bool allocator_t<T, MANTISSA_BITS>::tryGrow(allocation_t<T> allocation, T newSize)
             {
-                node.binListPrev                    = node_t::NIL;
-                node.binListNext                    = m_freeListHead;
-                m_nodes[m_freeListHead].binListPrev = nodeIndex;
-                m_freeListHead                      = nodeIndex;
-            }
+                ASSERT(allocation.metadata != allocation_t<T>::NO_SPACE);
+                if (!m_nodes)
+                    return false;
+
+                const u32 nodeIndex = (u32)allocation.metadata;
+                node_t&   node      = m_nodes[nodeIndex];
+                ASSERT(isUsed(nodeIndex) && !isDeferred(nodeIndex));
+                if (newSize <= node.dataSize)
+                    return shrink(allocation, newSize);
+
+                // The next neighbor must be free and hold the additional size
+                const T   additionalSize = newSize - node.dataSize;
+                const u32 nextIndex      = node.neighbor.next;
+                if (nextIndex == node_t::NIL || isUsed(nextIndex) || m_nodes[nextIndex].dataSize < additionalSize)
+                    return false;
+
+                const T   nextOffset = m_nodes[nextIndex].dataOffset;
+                const T   nextSize   = m_nodes[nextIndex].dataSize;
+                u32       nodeNext   = m_nodes[nextIndex].neighbor.next;
+                removeNodeFromBin(nextIndex);
+
+                // Push back the part of the next node that is left
+                const T reminderSize = nextSize - additionalSize;
+                if (reminderSize > 0)
+                {
+                    const u32 newNodeIndex              = insertNodeIntoBin(reminderSize, nextOffset + additionalSize);
+                    m_nodes[newNodeIndex].neighbor.prev = nodeIndex;
+                    m_nodes[newNodeIndex].neighbor.next = nodeNext;
+                    if (nodeNext != node_t::NIL)
+                        m_nodes[nodeNext].neighbor.prev = newNodeIndex;
+                    nodeNext = newNodeIndex;
+                }
+                else if (nodeNext != node_t::NIL)
+                {
+                    m_nodes[nodeNext].neighbor.prev = nodeIndex;
+                }
 
-            // Insert the (combined) free node to bin
-            const u32 combinedNodeIndex = insertNodeIntoBin(size, offset);
+                node.neighbor.next = nodeNext;
+                node.dataSize      = newSize;
+                return true;
+            }
 
-            // Connect neighbors with the new combined node
-            if (nodeNext != node_t::NIL)
+            template <typename T, u32 MANTISSA_BITS>
+            bool allocator_t<T, MANTISSA_BITS>::shrink(allocation_t<T> allocation, T newSize)
             {
-                m_neighbors[combinedNodeIndex].next = (nodeNext);
-                m_neighbors[nodeNext].prev          = combinedNodeIndex;
+                ASSERT(allocation.metadata != allocation_t<T>::NO_SPACE);
+                if (!m_nodes)
+                    return false;
+
+                const u32 nodeIndex = (u32)allocation.metadata;
+                node_t&   node      = m_nodes[nodeIndex];
+                ASSERT(isUsed(nodeIndex) && !isDeferred(nodeIndex));
+                ASSERT(newSize <= node.dataSize);
+                if (newSize == node.dataSize)
+                    return true;
+
+                // The tail is merged with the next neighbor when that one is free, otherwise it needs a node
+                T   tailSize = node.dataSize - newSize;
+                u32 nodeNext = node.neighbor.next;
+                if (nodeNext != node_t::NIL && !isUsed(nodeNext))
+                {
+                    tailSize += m_nodes[nodeNext].dataSize;
+                    removeNodeFromBin(nodeNext);
+                    nodeNext = m_nodes[nodeNext].neighbor.next;
+                }
+                else if (m_freeOffset == 0)
+                {
+                    return false;
+                }
+
+                const u32 tailNodeIndex              = insertNodeIntoBin(tailSize, node.dataOffset + newSize);
+                m_nodes[tailNodeIndex].neighbor.prev = nodeIndex;
+                m_nodes[tailNodeIndex].neighbor.next = nodeNext;
+                if (nodeNext != node_t::NIL)
+                    m_nodes[nodeNext].neighbor.prev = tailNodeIndex;
+
+                node.neighbor.next = tailNodeIndex;
+                node.dataSize      = newSize;
+                return true;
             }
-            if (nodePrev != node_t::NIL)
+
+            template <typename T, u32 MANTISSA_BITS>
+            u32 allocator_t<T, MANTISSA_BITS>::allocateMany(T const* sizes, u32 count, allocation_t<T>* outAllocations)
             {
-                m_neighbors[combinedNodeIndex].prev = nodePrev;
-                m_neighbors[nodePrev].next          = (combinedNodeIndex);
-            }
-        }
+                u64 totalSize = 0;
+                for (u32 i = 0; i < count; i++)
+                    totalSize += sizes[i];
 
-        u32 offset_allocator_t::insertNodeIntoBin(u32 size, u32 dataOffset)
-        {
-            // Round down to bin index to ensure that bin >= alloc
-            u32 binIndex = nfloat::uintToFloatRoundDown(size);
+                // Every allocation but the first takes a node, plus one for the remainder
+                u32 binIndex = NO_BIN;
+                if (count > 1 && m_freeOffset >= count && totalSize <= m_freeStorage)
+                    binIndex = findFreeBin((T)totalSize);
+
+                if (binIndex == NO_BIN)
+                {
+                    // No single free node can hold the whole batch, allocate one by one
+                    u32 numAllocated = 0;
+                    for (u32 i = 0; i < count; i++)
+                    {
+                        outAllocations[i] = allocate(sizes[i]);
+                        if (outAllocations[i].offset != allocation_t<T>::NO_SPACE)
+                            numAllocated++;
+                    }
+                    return numAllocated;
+                }
 
-            u32 topBinIndex  = binIndex >> TOP_BINS_INDEX_SHIFT;
-            u32 leafBinIndex = binIndex & LEAF_BINS_INDEX_MASK;
+                // Take the whole batch as one allocation, this updates the bins only once
+                const allocation_t<T> batch = allocateFromBin(binIndex, (T)totalSize, 1, HINT_NONE);
 
-            // Bin was empty before?
-            if (m_binIndices[binIndex] == node_t::NIL)
-            {
-                // Set bin mask bits
-                m_usedBins[topBinIndex] |= 1 << leafBinIndex;
-                m_usedBinsTop |= 1 << topBinIndex;
+                // Split the batch into contiguous used nodes, each linked after the previous one
+                u32 nodeIndex               = (u32)batch.metadata;
+                m_nodes[nodeIndex].dataSize = sizes[0];
+                outAllocations[0]           = batch;
+                for (u32 i = 1; i < count; i++)
+                {
+                    const T   dataOffset   = m_nodes[nodeIndex].dataOffset + m_nodes[nodeIndex].dataSize;
+                    const u32 newNodeIndex = popFreeNode();
+                    m_nodes[newNodeIndex]  = {.dataOffset = dataOffset, .dataSize = sizes[i]};
+                    setUsed(newNodeIndex);
+
+                    neighbor_t& neighbor = m_nodes[nodeIndex].neighbor;
+                    if (neighbor.next != node_t::NIL)
+                        m_nodes[neighbor.next].neighbor.prev = newNodeIndex;
+                    m_nodes[newNodeIndex].neighbor.prev = nodeIndex;
+                    m_nodes[newNodeIndex].neighbor.next = neighbor.next;
+                    neighbor.next                       = newNodeIndex;
+
+                    outAllocations[i] = {.offset = dataOffset, .metadata = newNodeIndex};
+                    nodeIndex         = newNodeIndex;
+                }
+                return count;
             }
 
-            // Take a freelist node and insert on top of the bin linked list (next = old top)
-            const u32 topNodeIndex = m_binIndices[binIndex];
-            u32       nodeIndex    = node_t::NIL;
-            if (m_freeListHead != node_t::NIL)
+            template <typename T, u32 MANTISSA_BITS>
+            u32 allocator_t<T, MANTISSA_BITS>::findFreeBin(T size) const
             {
-                nodeIndex      = m_freeListHead;
-                m_freeListHead = m_nodes[nodeIndex].binListNext;
-                if (m_freeListHead != node_t::NIL)
-                    m_nodes[m_freeListHead].binListPrev = node_t::NIL;
+                // Round up to bin index to ensure that alloc >= bin
+                // Gives us min bin index that fits the size
+                const u32 minBinIndex = nfloat::toFloatRoundUp<MANTISSA_BITS, T>(size);
+
+                const u32 minTopBinIndex  = minBinIndex >> TOP_BINS_INDEX_SHIFT;
+                const u32 minLeafBinIndex = minBinIndex & LEAF_BINS_INDEX_MASK;
+
+                u32 topBinIndex  = minTopBinIndex;
+                u32 leafBinIndex = NO_BIN;
+
+                // If top bin exists, scan its leaf bin. This can fail (NO_BIN).
+                if (m_usedBinsTop & ((T)1 << topBinIndex))
+                {
+                    leafBinIndex = findLowestSetBitAfter((u32)m_usedBins[topBinIndex], minLeafBinIndex);
+                }
+
+                // If we didn't find space in top bin, we search top bin from +1
+                if (leafBinIndex == NO_BIN)
+                {
+                    topBinIndex = findLowestSetBitAfter(m_usedBinsTop, minTopBinIndex + 1);
+
+                    // Out of space?
+                    if (topBinIndex == NO_BIN)
+                    {
+                        return NO_BIN;
+                    }
+
+                    // All leaf bins here fit the alloc, since the top bin was rounded up. Start leaf search from bit 0.
+                    // NOTE: This search can't fail since at least one leaf bit was set because the top bit was set.
+                    leafBinIndex = tzcnt_nonzero((u32)m_usedBins[topBinIndex]);
+                }
+
+                return (topBinIndex << TOP_BINS_INDEX_SHIFT) | leafBinIndex;
             }
-            else if (m_freeIndex < m_maxAllocs)
+
+            template <typename T, u32 MANTISSA_BITS>
+            u32 allocator_t<T, MANTISSA_BITS>::findLargestBin() const
             {
-                nodeIndex = m_freeIndex++;
+                if (m_usedBinsTop == 0)
+                    return NO_BIN;
+
+                const u32 topBinIndex  = (NUM_TOP_BINS - 1) - lzcnt_nonzero(m_usedBinsTop);
+                const u32 leafBinIndex = 31 - lzcnt_nonzero((u32)m_usedBins[topBinIndex]);
+                return (topBinIndex << TOP_BINS_INDEX_SHIFT) | leafBinIndex;
             }
-            else
+
+            template <typename T, u32 MANTISSA_BITS>
+            allocation_t<T> allocator_t<T, MANTISSA_BITS>::allocateFromBin(u32 binIndex, T size, T alignment, hint_t hint)
             {
-                // Out of allocations
-                return node_t::NIL;
-            }
+                const u32 topBinIndex  = binIndex >> TOP_BINS_INDEX_SHIFT;
+                const u32 leafBinIndex = binIndex & LEAF_BINS_INDEX_MASK;
+
+                // Pop the top node of the bin. Bin top = node.next.
+                const u32   nodeIndex     = m_binIndices[binIndex];
+                node_t&     node          = m_nodes[nodeIndex];
+                neighbor_t& neighbor      = m_nodes[nodeIndex].neighbor;
+                T           nodeTotalSize = node.dataSize;
+                setUsed(nodeIndex);
+                m_binIndices[binIndex] = node.binListNext;
+                if (node.binListNext != node_t::NIL)
+                    m_nodes[node.binListNext].binListPrev = node_t::NIL;
+
+                m_binCounts[binIndex]--;
+                m_binTotals[binIndex] -= nodeTotalSize;
+                m_freeNodes--;
 
+                m_freeStorage -= nodeTotalSize;
 #ifdef DEBUG_VERBOSE
-            printf("Getting node %u from freelist[%u]\n", nodeIndex, m_freeOffset + 1);
+                printf("Free storage: %u (-%u) (allocate)\n", m_freeStorage, nodeTotalSize);
 #endif
-            m_nodes[nodeIndex]     = {.dataOffset = dataOffset, .dataSize = size, .binListNext = topNodeIndex};
-            m_neighbors[nodeIndex] = {.prev = node_t::NIL, .next = node_t::NIL};
-            setUnused(nodeIndex);
 
-            if (topNodeIndex != node_t::NIL)
-                m_nodes[topNodeIndex].binListPrev = nodeIndex;
-            m_binIndices[binIndex] = nodeIndex;
+                // Bin empty?
+                if (m_binIndices[binIndex] == node_t::NIL)
+                {
+                    m_usedBins[topBinIndex] &= ~(1u << leafBinIndex);  // Remove a leaf bin mask bit
+
+                    // All leaf bins empty?
+                    if (m_usedBins[topBinIndex] == 0)
+                    {
+                        m_usedBinsTop &= ~((T)1 << topBinIndex);  // Remove a top bin mask bit
+                    }
+                }
+
+                // Transient blocks are taken from the end of the node, all others from the start. Either way the
+                // block starts at an aligned offset.
+                T dataOffset = (node.dataOffset + alignment - 1) & ~(alignment - 1);
+                if (hint == HINT_TRANSIENT)
+                    dataOffset = (node.dataOffset + nodeTotalSize - size) & ~(alignment - 1);
+
+                // Push back the leading padding as its own free node in front of the current node.
+                // NOTE: The previous neighbor of a free node is never free, so there is nothing to merge the padding with.
+                const T paddingSize = dataOffset - node.dataOffset;
+                if (paddingSize > 0)
+                {
+                    const u32 newNodeIndex = insertNodeIntoBin(paddingSize, node.dataOffset);
+
+                    if (neighbor.prev != node_t::NIL)
+                        m_nodes[neighbor.prev].neighbor.next = newNodeIndex;
+                    m_nodes[newNodeIndex].neighbor.prev = neighbor.prev;
+                    m_nodes[newNodeIndex].neighbor.next = nodeIndex;
+                    neighbor.prev                       = newNodeIndex;
+
+                    node.dataOffset += paddingSize;
+                    nodeTotalSize -= paddingSize;
+                }
+                node.dataSize = size;
+
+                // Push back remaining N elements to a lower bin
+                const T reminderSize = nodeTotalSize - size;
+                if (reminderSize > 0)
+                {
+                    const u32 newNodeIndex = insertNodeIntoBin(reminderSize, node.dataOffset + size);
+
+                    // Link new node after the current node so that we can merge them later if both are free
+                    // And update the old next neighbor to point to the new node (in middle)
+                    if (neighbor.next != node_t::NIL)
+                        m_nodes[neighbor.next].neighbor.prev = newNodeIndex;
+                    m_nodes[newNodeIndex].neighbor.prev = nodeIndex;
+                    m_nodes[newNodeIndex].neighbor.next = neighbor.next;
+                    neighbor.next                       = newNodeIndex;
+                }
+
+                return {.offset = node.dataOffset, .metadata = nodeIndex};
+            }
+
+            template <typename T, u32 MANTISSA_BITS>
+            void allocator_t<T, MANTISSA_BITS>::free(allocation_t<T> allocation)
+            {
+                ASSERT(allocation.metadata != allocation_t<T>::NO_SPACE);
+                if (!m_nodes)
+                    return;
+
+                const u32   nodeIndex = (u32)allocation.metadata;
+                node_t&     node      = m_nodes[nodeIndex];
+                neighbor_t& neighbor  = m_nodes[nodeIndex].neighbor;
+
+                // Double delete check
+                ASSERT(isUsed(nodeIndex));
+
+                // Merge with neighbors...
+                T offset = node.dataOffset;
+                T size   = node.dataSize;
+
+                if ((neighbor.prev != node_t::NIL) && (isUsed(neighbor.prev) == false))
+                {
+                    // Previous (contiguous) free node: Change offset to previous node offset. Sum sizes
+                    node_t&     prevNode     = m_nodes[neighbor.prev];
+                    neighbor_t& prevNeighbor = m_nodes[neighbor.prev].neighbor;
+                    offset                   = prevNode.dataOffset;
+                    size += prevNode.dataSize;
+
+                    // Remove node from the bin linked list and put it in the freelist
+                    removeNodeFromBin(neighbor.prev);
+
+                    ASSERT(prevNeighbor.next == nodeIndex);
+                    neighbor.prev = prevNeighbor.prev;
+                }
+
+                if ((neighbor.next != node_t::NIL) && (isUsed(neighbor.next) == false))
+                {
+                    // Next (contiguous) free node: Offset remains the same. Sum sizes.
+                    neighbor_t& nextNeighbor = m_nodes[neighbor.next].neighbor;
+                    node_t&     nextNode     = m_nodes[neighbor.next];
+                    size += nextNode.dataSize;
+
+                    // Remove node from the bin linked list and put it in the freelist
+                    removeNodeFromBin(neighbor.next);
 
-            m_freeStorage += size;
+                    ASSERT(nextNeighbor.prev == nodeIndex);
+                    neighbor.next = (nextNeighbor.next);
+                }
+
+                const u32 nodeNext = neighbor.next;
+                const u32 nodePrev = neighbor.prev;
+
+                // Insert the removed node to freelist
 #ifdef DEBUG_VERBOSE
-            printf("Free storage: %u (+%u) (insertNodeIntoBin)\n", m_freeStorage, size);
+                printf("Putting node %u into freelist[%u] (free)\n", nodeIndex, m_freeOffset + 1);
 #endif
+                pushFreeNode(nodeIndex);
 
-            return nodeIndex;
-        }
+                // Insert the (combined) free node to bin
+                const u32 combinedNodeIndex = insertNodeIntoBin(size, offset);
 
-        void offset_allocator_t::removeNodeFromBin(u32 nodeIndex)
-        {
-            node_t& node = m_nodes[nodeIndex];
+                // Connect neighbors with the new combined node
+                if (nodeNext != node_t::NIL)
+                {
+                    m_nodes[combinedNodeIndex].neighbor.next = (nodeNext);
+                    m_nodes[nodeNext].neighbor.prev          = combinedNodeIndex;
+                }
+                if (nodePrev != node_t::NIL)
+                {
+                    m_nodes[combinedNodeIndex].neighbor.prev = nodePrev;
+                    m_nodes[nodePrev].neighbor.next          = (combinedNodeIndex);
+                }
+            }
 
-            if (node.binListPrev != node_t::NIL)
+            template <typename T, u32 MANTISSA_BITS>
+            void allocator_t<T, MANTISSA_BITS>::freeMany(allocation_t<T>* allocations, u32 count)
             {
-                // Easy case: We have previous node. Just remove this node from the middle of the list.
-                m_nodes[node.binListPrev].binListNext = node.binListNext;
-                if (node.binListNext != node_t::NIL)
-                    m_nodes[node.binListNext].binListPrev = node.binListPrev;
+                if (!m_nodes)
+                    return;
+
+                sortAllocationsByOffset(allocations, count);
+
+                u32 i = 0;
+                while (i < count)
+                {
+                    ASSERT(allocations[i].metadata != allocation_t<T>::NO_SPACE);
+
+                    // Collect a run of physically neighboring blocks that are all freed, free nodes in between are absorbed
+                    const u32 firstNodeIndex = (u32)allocations[i].metadata;
+                    u32       lastNodeIndex  = firstNodeIndex;
+                    T         offset         = m_nodes[firstNodeIndex].dataOffset;
+                    T         size           = m_nodes[firstNodeIndex].dataSize;
+
+                    // Double delete check
+                    ASSERT(isUsed(firstNodeIndex));
+
+                    for (i = i + 1; i < count; i++)
+                    {
+                        const u32 nodeIndex = (u32)allocations[i].metadata;
+                        u32       nextIndex = m_nodes[lastNodeIndex].neighbor.next;
+                        if (nextIndex != nodeIndex && nextIndex != node_t::NIL && !isUsed(nextIndex) && m_nodes[nextIndex].neighbor.next == nodeIndex)
+                        {
+                            size += m_nodes[nextIndex].dataSize;
+                            removeNodeFromBin(nextIndex);
+                            nextIndex = nodeIndex;
+                        }
+                        if (nextIndex != nodeIndex)
+                            break;
+
+                        ASSERT(isUsed(nodeIndex));
+                        size += m_nodes[nodeIndex].dataSize;
+                        pushFreeNode(lastNodeIndex);
+                        lastNodeIndex = nodeIndex;
+                    }
+
+                    u32 nodePrev = m_nodes[firstNodeIndex].neighbor.prev;
+                    u32 nodeNext = m_nodes[lastNodeIndex].neighbor.next;
+
+                    if ((nodePrev != node_t::NIL) && (isUsed(nodePrev) == false))
+                    {
+                        // Previous (contiguous) free node: Change offset to previous node offset. Sum sizes
+                        offset = m_nodes[nodePrev].dataOffset;
+                        size += m_nodes[nodePrev].dataSize;
+                        removeNodeFromBin(nodePrev);
+                        nodePrev = m_nodes[nodePrev].neighbor.prev;
+                    }
+
+                    if ((nodeNext != node_t::NIL) && (isUsed(nodeNext) == false))
+                    {
+                        // Next (contiguous) free node: Offset remains the same. Sum sizes.
+                        size += m_nodes[nodeNext].dataSize;
+                        removeNodeFromBin(nodeNext);
+                        nodeNext = m_nodes[nodeNext].neighbor.next;
+                    }
+
+                    pushFreeNode(lastNodeIndex);
+
+                    // Insert the (combined) free node to bin and connect neighbors with it
+                    const u32 combinedNodeIndex = insertNodeIntoBin(size, offset);
+                    if (nodeNext != node_t::NIL)
+                    {
+                        m_nodes[combinedNodeIndex].neighbor.next = nodeNext;
+                        m_nodes[nodeNext].neighbor.prev          = combinedNodeIndex;
+                    }
+                    if (nodePrev != node_t::NIL)
+                    {
+                        m_nodes[combinedNodeIndex].neighbor.prev = nodePrev;
+                        m_nodes[nodePrev].neighbor.next          = combinedNodeIndex;
+                    }
+                }
             }
-            else
+
+            template <typename T, u32 MANTISSA_BITS>
+            u32 allocator_t<T, MANTISSA_BITS>::defragment(defrag_move_t<T>* outMoves, u32 maxMoves, T maxBytes, T alignment)
             {
-                // Hard case: We are the first node in a bin. Find the bin.
+                ASSERT(alignment != 0 && (alignment & (alignment - 1)) == 0);  // Alignment must be a power of 2
+                if (!m_nodes || m_usedBinsTop == 0)
+                    return 0;
+
+                // Any free node is part of the neighbor chain, walk back to the node at offset 0
+                const u32 topBinIndex  = tzcnt_nonzero(m_usedBinsTop);
+                const u32 leafBinIndex = tzcnt_nonzero((u32)m_usedBins[topBinIndex]);
+                u32       nodeIndex    = m_binIndices[(topBinIndex << TOP_BINS_INDEX_SHIFT) | leafBinIndex];
+                while (m_nodes[nodeIndex].neighbor.prev != node_t::NIL)
+                    nodeIndex = m_nodes[nodeIndex].neighbor.prev;
+
+                u32 numMoves = 0;
+                T   numBytes = 0;
+                while (numMoves < maxMoves)
+                {
+                    // Find the next free node
+                    while (nodeIndex != node_t::NIL && isUsed(nodeIndex))
+                        nodeIndex = m_nodes[nodeIndex].neighbor.next;
+                    if (nodeIndex == node_t::NIL)
+                        break;
+
+                    // The neighbors of a free node are always used, so swap the free node with the next node
+                    const u32 usedNodeIndex = m_nodes[nodeIndex].neighbor.next;
+                    if (usedNodeIndex == node_t::NIL)
+                        break;
+                    ASSERT(isUsed(usedNodeIndex));
+
+                    node_t&   usedNode   = m_nodes[usedNodeIndex];
+                    const T   freeOffset = m_nodes[nodeIndex].dataOffset;
+                    const T   dstOffset  = (freeOffset + alignment - 1) & ~(alignment - 1);
+                    if (dstOffset >= usedNode.dataOffset || isDeferred(usedNodeIndex))
+                    {
+                        // Free space is too small to move the block to an aligned offset or the block is still
+                        // referenced by a deferred free, continue after it
+                        nodeIndex = m_nodes[usedNodeIndex].neighbor.next;
+                        continue;
+                    }
+
+                    // Out of space (budget) or out of allocations (the leading padding can cost an extra node)?
+                    if (usedNode.dataSize > (maxBytes - numBytes) || m_freeOffset == 0)
+                        break;
+
+                    const T   paddingSize = dstOffset - freeOffset;
+                    T         freeSize    = usedNode.dataOffset - dstOffset;
+                    u32       nodePrev    = m_nodes[nodeIndex].neighbor.prev;
+                    u32       nodeNext    = m_nodes[usedNodeIndex].neighbor.next;
+                    removeNodeFromBin(nodeIndex);
+
+                    // The free space ends up in front of the next node, merge when that one is free as well
+                    if ((nodeNext != node_t::NIL) && (isUsed(nodeNext) == false))
+                    {
+                        freeSize += m_nodes[nodeNext].dataSize;
+                        removeNodeFromBin(nodeNext);
+                        nodeNext = m_nodes[nodeNext].neighbor.next;
+                    }
 
+                    // The padding in front of the aligned offset stays a free node
+                    if (paddingSize > 0)
+                    {
+                        const u32 paddingNodeIndex = insertNodeIntoBin(paddingSize, freeOffset);
+                        m_nodes[paddingNodeIndex].neighbor.prev = nodePrev;
+                        if (nodePrev != node_t::NIL)
+                            m_nodes[nodePrev].neighbor.next = paddingNodeIndex;
+                        nodePrev = paddingNodeIndex;
+                    }
+
+                    outMoves[numMoves++] = {.srcOffset = usedNode.dataOffset, .dstOffset = dstOffset, .size = usedNode.dataSize, .metadata = usedNodeIndex};
+                    numBytes += usedNode.dataSize;
+                    usedNode.dataOffset = dstOffset;
+
+                    nodeIndex = insertNodeIntoBin(freeSize, dstOffset + usedNode.dataSize);
+
+                    // Relink: prev <-> used <-> free <-> next
+                    if (nodePrev != node_t::NIL)
+                        m_nodes[nodePrev].neighbor.next = usedNodeIndex;
+                    m_nodes[usedNodeIndex].neighbor.prev = nodePrev;
+                    m_nodes[usedNodeIndex].neighbor.next = nodeIndex;
+                    m_nodes[nodeIndex].neighbor.prev     = usedNodeIndex;
+                    m_nodes[nodeIndex].neighbor.next     = nodeNext;
+                    if (nodeNext != node_t::NIL)
+                        m_nodes[nodeNext].neighbor.prev = nodeIndex;
+                }
+
+                return numMoves;
+            }
+
+            template <typename T, u32 MANTISSA_BITS>
+            u32 allocator_t<T, MANTISSA_BITS>::insertNodeIntoBin(T size, T dataOffset)
+            {
                 // Round down to bin index to ensure that bin >= alloc
-                u32 binIndex = nfloat::uintToFloatRoundDown(node.dataSize);
+                u32 binIndex = nfloat::toFloatRoundDown<MANTISSA_BITS, T>(size);
 
                 u32 topBinIndex  = binIndex >> TOP_BINS_INDEX_SHIFT;
                 u32 leafBinIndex = binIndex & LEAF_BINS_INDEX_MASK;
 
-                m_binIndices[binIndex] = node.binListNext;
-                if (node.binListNext != node_t::NIL)
-                    m_nodes[node.binListNext].binListPrev = node_t::NIL;
-
-                // Bin empty?
+                // Bin was empty before?
                 if (m_binIndices[binIndex] == node_t::NIL)
                 {
-                    // Remove a leaf bin mask bit
-                    m_usedBins[topBinIndex] &= ~(1 << leafBinIndex);
+                    // Set bin mask bits
+                    m_usedBins[topBinIndex] |= 1u << leafBinIndex;
+                    m_usedBinsTop |= (T)1 << topBinIndex;
+                }
 
-                    // All leaf bins empty?
-                    if (m_usedBins[topBinIndex] == 0)
+                // Take a freelist node and insert on top of the bin linked list (next = old top)
+                const u32 topNodeIndex = m_binIndices[binIndex];
+                const u32 nodeIndex    = popFreeNode();
+                if (nodeIndex == node_t::NIL)
+                {
+                    // Out of allocations
+                    return node_t::NIL;
+                }
+
+#ifdef DEBUG_VERBOSE
+                printf("Getting node %u from freelist[%u]\n", nodeIndex, m_freeOffset + 1);
+#endif
+                m_nodes[nodeIndex] = {.dataOffset = dataOffset, .dataSize = size, .binListNext = topNodeIndex};
+
+                if (topNodeIndex != node_t::NIL)
+                    m_nodes[topNodeIndex].binListPrev = nodeIndex;
+                m_binIndices[binIndex] = nodeIndex;
+
+                m_binCounts[binIndex]++;
+                m_binTotals[binIndex] += size;
+                m_freeNodes++;
+
+                m_freeStorage += size;
+#ifdef DEBUG_VERBOSE
+                printf("Free storage: %u (+%u) (insertNodeIntoBin)\n", m_freeStorage, size);
+#endif
+
+                return nodeIndex;
+            }
+
+            template <typename T, u32 MANTISSA_BITS>
+            void allocator_t<T, MANTISSA_BITS>::removeNodeFromBin(u32 nodeIndex)
+            {
+                node_t& node = m_nodes[nodeIndex];
+
+                // Round down to bin index to ensure that bin >= alloc
+                const u32 binIndex = nfloat::toFloatRoundDown<MANTISSA_BITS, T>(node.dataSize);
+                m_binCounts[binIndex]--;
+                m_binTotals[binIndex] -= node.dataSize;
+                m_freeNodes--;
+
+                if (node.binListPrev != node_t::NIL)
+                {
+                    // Easy case: We have previous node. Just remove this node from the middle of the list.
+                    m_nodes[node.binListPrev].binListNext = node.binListNext;
+                    if (node.binListNext != node_t::NIL)
+                        m_nodes[node.binListNext].binListPrev = node.binListPrev;
+                }
+                else
+                {
+                    // Hard case: We are the first node in a bin.
+                    u32 topBinIndex  = binIndex >> TOP_BINS_INDEX_SHIFT;
+                    u32 leafBinIndex = binIndex & LEAF_BINS_INDEX_MASK;
+
+                    m_binIndices[binIndex] = node.binListNext;
+                    if (node.binListNext != node_t::NIL)
+                        m_nodes[node.binListNext].binListPrev = node_t::NIL;
+
+                    // Bin empty?
+                    if (m_binIndices[binIndex] == node_t::NIL)
                     {
-                        // Remove a top bin mask bit
-                        m_usedBinsTop &= ~(1 << topBinIndex);
+                        // Remove a leaf bin mask bit
+                        m_usedBins[topBinIndex] &= ~(1u << leafBinIndex);
+
+                        // All leaf bins empty?
+                        if (m_usedBins[topBinIndex] == 0)
+                        {
+                            // Remove a top bin mask bit
+                            m_usedBinsTop &= ~((T)1 << topBinIndex);
+                        }
                     }
                 }
-            }
 
-            // Insert the node to freelist
+                // Insert the node to freelist
 #ifdef DEBUG_VERBOSE
-            printf("Putting node %u into freelist[%u] (removeNodeFromBin)\n", nodeIndex, m_freeOffset + 1);
+                printf("Putting node %u into freelist[%u] (removeNodeFromBin)\n", nodeIndex, m_freeOffset + 1);
 #endif
-            if (m_freeListHead == node_t::NIL)
+                pushFreeNode(nodeIndex);
+
+                m_freeStorage -= node.dataSize;
+#ifdef DEBUG_VERBOSE
+                printf("Free storage: %u (-%u) (removeNodeFromBin)\n", m_freeStorage, node.getDataSize());
+#endif
+            }
+
+            template <typename T, u32 MANTISSA_BITS>
+            u32 allocator_t<T, MANTISSA_BITS>::popFreeNode()
+            {
+                u32 nodeIndex = node_t::NIL;
+                if (m_freeListHead != node_t::NIL)
+                {
+                    nodeIndex      = m_freeListHead;
+                    m_freeListHead = m_nodes[nodeIndex].binListNext;
+                    if (m_freeListHead != node_t::NIL)
+                        m_nodes[m_freeListHead].binListPrev = node_t::NIL;
+                }
+                else if (m_freeIndex < m_maxAllocs)
+                {
+                    nodeIndex = m_freeIndex++;
+                }
+                else
+                {
+                    // Out of allocations
+                    return node_t::NIL;
+                }
+                m_freeOffset--;
+                return nodeIndex;
+            }
+
+            template <typename T, u32 MANTISSA_BITS>
+            void allocator_t<T, MANTISSA_BITS>::pushFreeNode(u32 nodeIndex)
             {
+                // m_freeListHead is the head of the freelist. node.binListNext is the next node in the freelist.
+                node_t& node     = m_nodes[nodeIndex];
                 node.binListPrev = node_t::NIL;
-                node.binListNext = node_t::NIL;
-                m_freeListHead   = nodeIndex;
+                node.binListNext = m_freeListHead;
+                if (m_freeListHead != node_t::NIL)
+                    m_nodes[m_freeListHead].binListPrev = nodeIndex;
+                m_freeListHead = nodeIndex;
+                m_freeOffset++;
+
+                // The node is not part of the neighbor chain anymore
+                if (m_cursorNode == nodeIndex)
+                    m_cursorNode = node_t::NIL;
             }
-            else
+
+            template <typename T, u32 MANTISSA_BITS>
+            u32 allocator_t<T, MANTISSA_BITS>::findLiveNode() const
             {
-                node.binListPrev                    = node_t::NIL;
-                node.binListNext                    = m_freeListHead;
-                m_nodes[m_freeListHead].binListPrev = nodeIndex;
-                m_freeListHead                      = nodeIndex;
+                // Any live node, a free node at the head of a bin or otherwise the first used node
+                u32 nodeIndex = node_t::NIL;
+                if (m_usedBinsTop != 0)
+                {
+                    const u32 topBinIndex  = tzcnt_nonzero(m_usedBinsTop);
+                    const u32 leafBinIndex = tzcnt_nonzero((u32)m_usedBins[topBinIndex]);
+                    nodeIndex              = m_binIndices[(topBinIndex << TOP_BINS_INDEX_SHIFT) | leafBinIndex];
+                }
+                else
+                {
+                    for (u32 i = 0; i < m_freeIndex; i++)
+                    {
+                        if (isUsed(i))
+                        {
+                            nodeIndex = i;
+                            break;
+                        }
+                    }
+                }
+                return nodeIndex;
             }
 
-            m_freeStorage -= node.dataSize;
-#ifdef DEBUG_VERBOSE
-            printf("Free storage: %u (-%u) (removeNodeFromBin)\n", m_freeStorage, node.getDataSize());
-#endif
-        }
+            template <typename T, u32 MANTISSA_BITS>
+            u32 allocator_t<T, MANTISSA_BITS>::findTailNode() const
+            {
+                u32 nodeIndex = findLiveNode();
+                ASSERT(nodeIndex != node_t::NIL);
 
-        u32 offset_allocator_t::allocationSize(allocation_t allocation) const
-        {
-            if (allocation.metadata == allocation_t::NO_SPACE || !m_nodes)
-                return 0;
+                while (m_nodes[nodeIndex].neighbor.next != node_t::NIL)
+                    nodeIndex = m_nodes[nodeIndex].neighbor.next;
+                return nodeIndex;
+            }
 
-            return m_nodes[allocation.metadata].dataSize;
-        }
+            template <typename T, u32 MANTISSA_BITS>
+            bool allocator_t<T, MANTISSA_BITS>::heapFirst(heap_run_t<T>& run) const
+            {
+                if (!m_nodes)
+                    return false;
+
+                u32 nodeIndex = findLiveNode();
+                if (nodeIndex == node_t::NIL)
+                    return false;
+                while (m_nodes[nodeIndex].neighbor.prev != node_t::NIL)
+                    nodeIndex = m_nodes[nodeIndex].neighbor.prev;
+
+                const node_t& node = m_nodes[nodeIndex];
+                run                = {.offset = node.dataOffset, .size = node.dataSize, .used = isUsed(nodeIndex), .node = nodeIndex};
+                return true;
+            }
 
-        storage_report_t offset_allocator_t::storageReport() const
-        {
-            u32 largestFreeRegion = 0;
-            u32 freeStorage       = 0;
+            template <typename T, u32 MANTISSA_BITS>
+            bool allocator_t<T, MANTISSA_BITS>::heapNext(heap_run_t<T>& run) const
+            {
+                const u32 nodeIndex = m_nodes[run.node].neighbor.next;
+                if (nodeIndex == node_t::NIL)
+                    return false;
 
-            // Out of allocations? -> Zero free space
-            if (m_freeOffset > 0)
+                const node_t& node = m_nodes[nodeIndex];
+                run                = {.offset = node.dataOffset, .size = node.dataSize, .used = isUsed(nodeIndex), .node = nodeIndex};
+                return true;
+            }
+
+            template <typename T, u32 MANTISSA_BITS>
+            u32 allocator_t<T, MANTISSA_BITS>::freeRunHistogram(u32* outCounts, u32 numBuckets) const
             {
-                freeStorage = m_freeStorage;
-                if (m_usedBinsTop)
+                for (u32 i = 0; i < numBuckets; i++)
+                    outCounts[i] = 0;
+
+                u32           numFree = 0;
+                heap_run_t<T> run;
+                for (bool valid = heapFirst(run); valid; valid = heapNext(run))
                 {
-                    u32 topBinIndex   = 31 - lzcnt_nonzero(m_usedBinsTop);
-                    u32 leafBinIndex  = 31 - lzcnt_nonzero(m_usedBins[topBinIndex]);
-                    largestFreeRegion = nfloat::floatToUint((topBinIndex << TOP_BINS_INDEX_SHIFT) | leafBinIndex);
-                    ASSERT(freeStorage >= largestFreeRegion);
+                    if (run.used)
+                        continue;
+                    u32 bucket = run.size > 1 ? (sizeof(T) * 8 - 1) - lzcnt_nonzero(run.size) : 0;
+                    if (bucket >= numBuckets)
+                        bucket = numBuckets - 1;
+                    outCounts[bucket]++;
+                    numFree++;
                 }
+                return numFree;
             }
 
-            return {.totalFreeSpace = freeStorage, .largestFreeRegion = largestFreeRegion};
-        }
+            template <typename T, u32 MANTISSA_BITS>
+            void allocator_t<T, MANTISSA_BITS>::occupancyMap(u8* outMap, u32 numCells) const
+            {
+                const T cellSize = (m_size + numCells - 1) / numCells;
 
-        full_storage_report_t offset_allocator_t::storageReportFull() const
-        {
-            full_storage_report_t report;
-            for (u32 i = 0; i < NUM_LEAF_BINS; i++)
+                heap_run_t<T> run;
+                bool          valid = heapFirst(run);
+                for (u32 cell = 0; cell < numCells; cell++)
+                {
+                    const T cellBegin = (T)cell * cellSize;
+                    const T cellEnd   = (cellBegin + cellSize) < m_size ? (cellBegin + cellSize) : m_size;
+                    if (cellBegin >= cellEnd)
+                    {
+                        outMap[cell] = 0;
+                        continue;
+                    }
+
+                    // Sum the used bytes of the runs that overlap the cell, a run can span multiple cells
+                    T used = 0;
+                    while (valid && run.offset < cellEnd)
+                    {
+                        const T runEnd = run.offset + run.size;
+                        if (run.used)
+                        {
+                            const T begin = run.offset > cellBegin ? run.offset : cellBegin;
+                            const T end   = runEnd < cellEnd ? runEnd : cellEnd;
+                            if (end > begin)
+                                used += end - begin;
+                        }
+                        if (runEnd > cellEnd)
+                            break;
+                        valid = heapNext(run);
+                    }
+                    outMap[cell] = (u8)(((f32)used * 255.0f) / (f32)(cellEnd - cellBegin));
+                }
+            }
+
+            template <typename T, u32 MANTISSA_BITS>
+            void allocator_t<T, MANTISSA_BITS>::freeDeferred(allocation_t<T> allocation, u64 frame)
+            {
+                ASSERT(allocation.metadata != allocation_t<T>::NO_SPACE);
+                if (!m_nodes)
+                    return;
+
+                const u32 nodeIndex = (u32)allocation.metadata;
+                ASSERT(isUsed(nodeIndex) && !isDeferred(nodeIndex));
+
+                if (m_deferredCount == m_deferredCapacity)
+                    growDeferred();
+
+                // Frames are non-decreasing, so the ring stays ordered by frame
+                const u32 tail = (m_deferredHead + m_deferredCount) % m_deferredCapacity;
+                ASSERT(m_deferredCount == 0 || m_deferredFrames[(tail + m_deferredCapacity - 1) % m_deferredCapacity] <= frame);
+
+                m_deferred[tail]       = allocation;
+                m_deferredFrames[tail] = frame;
+                m_deferredCount++;
+                m_deferredSize += m_nodes[nodeIndex].dataSize;
+                m_deferredNodes[nodeIndex >> 5] |= (1u << (nodeIndex & 31));
+            }
+
+            template <typename T, u32 MANTISSA_BITS>
+            u32 allocator_t<T, MANTISSA_BITS>::retire(u64 frame)
             {
-                u32 count     = 0;
-                u32 nodeIndex = m_binIndices[i];
-                while (nodeIndex != node_t::NIL)
+                u32 count = 0;
+                while (count < m_deferredCount && m_deferredFrames[(m_deferredHead + count) % m_deferredCapacity] <= frame)
                 {
-                    nodeIndex = m_nodes[nodeIndex].binListNext;
+                    const u32 nodeIndex = (u32)m_deferred[(m_deferredHead + count) % m_deferredCapacity].metadata;
+                    m_deferredNodes[nodeIndex >> 5] &= ~(1u << (nodeIndex & 31));
+                    m_deferredSize -= m_nodes[nodeIndex].dataSize;
                     count++;
                 }
-                report.freeRegions[i] = {.size = nfloat::floatToUint(i), .count = count};
+                if (count == 0)
+                    return 0;
+
+                // The expired entries are contiguous in the ring unless they wrap around the end
+                const u32 first = (m_deferredCapacity - m_deferredHead) < count ? (m_deferredCapacity - m_deferredHead) : count;
+                freeMany(m_deferred + m_deferredHead, first);
+                if (first < count)
+                    freeMany(m_deferred, count - first);
+
+                m_deferredHead = (m_deferredHead + count) % m_deferredCapacity;
+                m_deferredCount -= count;
+                return count;
             }
-            return report;
-        }
+
+            template <typename T, u32 MANTISSA_BITS>
+            void allocator_t<T, MANTISSA_BITS>::growDeferred()
+            {
+                const u32        capacity = m_deferredCapacity == 0 ? 256 : m_deferredCapacity * 2;
+                allocation_t<T>* deferred = (allocation_t<T>*)m_allocator->allocate(sizeof(allocation_t<T>) * capacity);
+                u64*             frames   = (u64*)m_allocator->allocate(sizeof(u64) * capacity);
+
+                // Unwrap the ring
+                for (u32 i = 0; i < m_deferredCount; i++)
+                {
+                    const u32 j = (m_deferredHead + i) % m_deferredCapacity;
+                    deferred[i] = m_deferred[j];
+                    frames[i]   = m_deferredFrames[j];
+                }
+
+                if (m_deferred)
+                {
+                    m_allocator->deallocate(m_deferred);
+                    m_allocator->deallocate(m_deferredFrames);
+                }
+                else
+                {
+                    m_deferredNodes = (u32*)m_allocator->allocate(((m_maxAllocs + 31) >> 5) * sizeof(u32));
+                    nmem::memset(m_deferredNodes, 0, ((m_maxAllocs + 31) >> 5) * sizeof(u32));
+                }
+
+                m_deferred         = deferred;
+                m_deferredFrames   = frames;
+                m_deferredHead     = 0;
+                m_deferredCapacity = capacity;
+            }
+
+            template <typename T, u32 MANTISSA_BITS>
+            u64 allocator_t<T, MANTISSA_BITS>::snapshotSize() const
+            {
+                u64 size = snapshotAlign(sizeof(snapshot_header_t));
+                size += snapshotAlign(sizeof(m_usedBins));
+                size += snapshotAlign(sizeof(m_binIndices));
+                size += snapshotAlign(sizeof(m_binCounts));
+                size += snapshotAlign(sizeof(m_binTotals));
+                size += snapshotAlign((u64)sizeof(node_t) * m_freeIndex);
+                return size;
+            }
+
+            template <typename T, u32 MANTISSA_BITS>
+            bool allocator_t<T, MANTISSA_BITS>::saveSnapshot(void* buffer, u64 bufferSize) const
+            {
+                if (!m_nodes || m_deferredCount > 0 || bufferSize < snapshotSize())
+                    return false;
+
+                u8*                ptr    = (u8*)buffer;
+                snapshot_header_t* header = (snapshot_header_t*)ptr;
+                header->magic             = SNAPSHOT_MAGIC;
+                header->version           = SNAPSHOT_VERSION;
+                header->offsetBytes       = sizeof(T);
+                header->mantissaBits      = MANTISSA_BITS;
+                header->maxAllocs         = m_maxAllocs;
+                header->numNodes          = m_freeIndex;
+                header->freeListHead      = m_freeListHead;
+                header->freeOffset        = m_freeOffset;
+                header->freeNodes         = m_freeNodes;
+                header->nodeBytes         = sizeof(node_t);
+                header->size              = m_size;
+                header->freeStorage       = m_freeStorage;
+                header->usedBinsTop       = m_usedBinsTop;
+                ptr += snapshotAlign(sizeof(snapshot_header_t));
+
+                nmem::memcpy(ptr, m_usedBins, sizeof(m_usedBins));
+                ptr += snapshotAlign(sizeof(m_usedBins));
+                nmem::memcpy(ptr, m_binIndices, sizeof(m_binIndices));
+                ptr += snapshotAlign(sizeof(m_binIndices));
+                nmem::memcpy(ptr, m_binCounts, sizeof(m_binCounts));
+                ptr += snapshotAlign(sizeof(m_binCounts));
+                nmem::memcpy(ptr, m_binTotals, sizeof(m_binTotals));
+                ptr += snapshotAlign(sizeof(m_binTotals));
+                nmem::memcpy(ptr, m_nodes, sizeof(node_t) * m_freeIndex);
+                return true;
+            }
+
+            template <typename T, u32 MANTISSA_BITS>
+            bool allocator_t<T, MANTISSA_BITS>::loadSnapshot(void const* buffer, u64 bufferSize)
+            {
+                if (!m_nodes || bufferSize < sizeof(snapshot_header_t))
+                    return false;
+
+                u8 const*                ptr    = (u8 const*)buffer;
+                snapshot_header_t const* header = (snapshot_header_t const*)ptr;
+                if (header->magic != SNAPSHOT_MAGIC || header->version != SNAPSHOT_VERSION || header->offsetBytes != sizeof(T) || header->mantissaBits != MANTISSA_BITS || header->nodeBytes != sizeof(node_t))
+                    return false;
+                if (header->maxAllocs > m_maxAllocs || header->numNodes > header->maxAllocs)
+                    return false;
+
+                const u64 nodesSize = (u64)sizeof(node_t) * header->numNodes;
+                const u64 size      = snapshotAlign(sizeof(snapshot_header_t)) + snapshotAlign(sizeof(m_usedBins)) + snapshotAlign(sizeof(m_binIndices)) + snapshotAlign(sizeof(m_binCounts)) +
+                                 snapshotAlign(sizeof(m_binTotals)) + snapshotAlign(nodesSize);
+                if (bufferSize < size)
+                    return false;
+
+                // Start from a clean state, this also drops the deferred frees
+                reset();
+
+                m_size         = (T)header->size;
+                m_freeStorage  = (T)header->freeStorage;
+                m_usedBinsTop  = (T)header->usedBinsTop;
+                m_freeIndex    = header->numNodes;
+                m_freeListHead = header->freeListHead;
+                m_freeOffset   = header->freeOffset + (m_maxAllocs - header->maxAllocs);
+                m_freeNodes    = header->freeNodes;
+                ptr += snapshotAlign(sizeof(snapshot_header_t));
+
+                nmem::memcpy(m_usedBins, ptr, sizeof(m_usedBins));
+                ptr += snapshotAlign(sizeof(m_usedBins));
+                nmem::memcpy(m_binIndices, ptr, sizeof(m_binIndices));
+                ptr += snapshotAlign(sizeof(m_binIndices));
+                nmem::memcpy(m_binCounts, ptr, sizeof(m_binCounts));
+                ptr += snapshotAlign(sizeof(m_binCounts));
+                nmem::memcpy(m_binTotals, ptr, sizeof(m_binTotals));
+                ptr += snapshotAlign(sizeof(m_binTotals));
+                nmem::memcpy(m_nodes, ptr, nodesSize);
+                return true;
+            }
+
+            template <typename T, u32 MANTISSA_BITS>
+            T allocator_t<T, MANTISSA_BITS>::allocationSize(allocation_t<T> allocation) const
+            {
+                if (allocation.metadata == allocation_t<T>::NO_SPACE || !m_nodes)
+                    return 0;
+
+                return m_nodes[allocation.metadata].dataSize;
+            }
+
+            template <typename T, u32 MANTISSA_BITS>
+            storage_report_t<T> allocator_t<T, MANTISSA_BITS>::storageReport() const
+            {
+                T largestFreeRegion = 0;
+                T freeStorage       = 0;
+
+                // Out of allocations? -> Zero free space
+                if (m_freeOffset > 0)
+                {
+                    freeStorage = m_freeStorage;
+                    if (m_usedBinsTop)
+                    {
+                        u32 topBinIndex   = (NUM_TOP_BINS - 1) - lzcnt_nonzero(m_usedBinsTop);
+                        u32 leafBinIndex  = 31 - lzcnt_nonzero((u32)m_usedBins[topBinIndex]);
+                        largestFreeRegion = c_binSizes<T, MANTISSA_BITS>.at((topBinIndex << TOP_BINS_INDEX_SHIFT) | leafBinIndex);
+                        ASSERT(freeStorage >= largestFreeRegion);
+                    }
+                }
+
+                return {.totalFreeSpace = freeStorage, .largestFreeRegion = largestFreeRegion, .inFlightSpace = m_deferredSize};
+            }
+
+            template <typename T, u32 MANTISSA_BITS>
+            full_storage_report_t<T, MANTISSA_BITS> allocator_t<T, MANTISSA_BITS>::storageReportFull() const
+            {
+                full_storage_report_t<T, MANTISSA_BITS> report;
+                for (u32 i = 0; i < NUM_LEAF_BINS; i++)
+                    report.freeRegions[i] = {.size = c_binSizes<T, MANTISSA_BITS>.at(i), .count = m_binCounts[i], .totalSize = m_binTotals[i]};
+                return report;
+            }
+
+            template <typename T, u32 MANTISSA_BITS>
+            fragmentation_report_t<T> allocator_t<T, MANTISSA_BITS>::fragmentationReport() const
+            {
+                fragmentation_report_t<T> report = {.freeBlockCount = m_freeNodes, .usedBlockCount = 0, .totalFreeSpace = m_freeStorage, .largestFreeBlock = 0, .fragmentation = 0.0f};
+                if (!m_nodes)
+                    return report;
+
+                // Live nodes are either free (in a bin) or used
+                report.usedBlockCount = ((m_maxAllocs - 1) - m_freeOffset) - m_freeNodes;
+
+                if (m_usedBinsTop)
+                {
+                    // The average size of the highest non-empty bin, exact when that bin holds a single block
+                    const u32 topBinIndex  = (NUM_TOP_BINS - 1) - lzcnt_nonzero(m_usedBinsTop);
+                    const u32 leafBinIndex = 31 - lzcnt_nonzero((u32)m_usedBins[topBinIndex]);
+                    const u32 binIndex     = (topBinIndex << TOP_BINS_INDEX_SHIFT) | leafBinIndex;
+                    report.largestFreeBlock = m_binTotals[binIndex] / m_binCounts[binIndex];
+                    if (m_freeStorage > 0)
+                        report.fragmentation = 1.0f - ((f32)report.largestFreeBlock / (f32)m_freeStorage);
+                }
+                return report;
+            }
+
+            // u32 and u64 offsets with 2 to 5 mantissa bits, offset_allocator_t and offset_allocator64_t use 3
+            template class allocator_t<u32, 2>;
+            template class allocator_t<u32, 3>;
+            template class allocator_t<u32, 4>;
+            template class allocator_t<u32, 5>;
+            template class allocator_t<u64, 2>;
+            template class allocator_t<u64, 3>;
+            template class allocator_t<u64, 4>;
+            template class allocator_t<u64, 5>;
+        }  // namespace noffset
     }  // namespace ngfx
 
 }  // namespace ncore
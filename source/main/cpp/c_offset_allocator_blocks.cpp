@@ -0,0 +1,212 @@
+#include "cgfxcommon/c_offset_allocator_blocks.h"
+
+#include "cbase/c_memory.h"
+#include "cbase/c_allocator.h"
+
+namespace ncore
+{
+    namespace ngfx
+    {
+        namespace nfloat
+        {
+            extern u32 uintToFloatRoundUp(u32 size);
+            extern u32 uintToFloatRoundDown(u32 size);
+        }  // namespace nfloat
+
+        offset_allocator_blocks_t::offset_allocator_blocks_t(alloc_t* allocator, u32 blockSize, u32 maxBlocks, u32 maxAllocsPerBlock, u32 cooldown)
+            : m_allocator(allocator)
+            , m_blocks(nullptr)
+            , m_tree(nullptr)
+            , m_treeLeaves(1)
+            , m_blockSize(blockSize)
+            , m_maxBlocks(maxBlocks)
+            , m_maxAllocsPerBlock(maxAllocsPerBlock)
+            , m_cooldown(cooldown)
+            , m_numBlocks(0)
+            , m_frame(0)
+        {
+            ASSERT(maxBlocks > 0);
+            while (m_treeLeaves < maxBlocks)
+                m_treeLeaves <<= 1;
+        }
+
+        offset_allocator_blocks_t::~offset_allocator_blocks_t() { teardown(); }
+
+        void offset_allocator_blocks_t::setup()
+        {
+            m_blocks = (block_t*)m_allocator->allocate(sizeof(block_t) * m_maxBlocks);
+            nmem::memset(m_blocks, 0, sizeof(block_t) * m_maxBlocks);
+            m_tree = (u32*)m_allocator->allocate(sizeof(u32) * m_treeLeaves * 2);
+            nmem::memset(m_tree, 0, sizeof(u32) * m_treeLeaves * 2);
+        }
+
+        void offset_allocator_blocks_t::teardown()
+        {
+            if (m_blocks)
+            {
+                for (u32 i = 0; i < m_maxBlocks; i++)
+                {
+                    if (m_blocks[i].m_allocator)
+                        releaseBlock(i);
+                }
+                m_allocator->deallocate(m_blocks);
+                m_allocator->deallocate(m_tree);
+            }
+            m_blocks    = nullptr;
+            m_tree      = nullptr;
+            m_numBlocks = 0;
+        }
+
+        block_allocation_t offset_allocator_blocks_t::allocate(u32 size, u32 alignment)
+        {
+            ASSERT(alignment != 0 && (alignment & (alignment - 1)) == 0);  // Alignment must be a power of 2
+
+            // Any free block of at least (size + alignment - 1) can hold the allocation at an aligned offset
+            const u32 minBin = nfloat::uintToFloatRoundUp(alignment > 1 ? size + alignment - 1 : size) + 1;
+
+            // First fit over the blocks, the lowest block id that can serve the request. This keeps the high blocks
+            // empty so that they can be released.
+            u32 block = findBlock(minBin);
+            while (block != NIL)
+            {
+                block_t&           b = m_blocks[block];
+                const allocation_t a = b.m_allocator->allocate(size, alignment);
+                if (a.offset != allocation_t::NO_SPACE)
+                {
+                    b.m_numAllocs++;
+                    b.m_emptyFrame = NEVER;
+                    updateBlock(block);
+                    return {.offset = a.offset, .metadata = a.metadata, .block = block};
+                }
+
+                // Out of nodes, hide the block until one of its allocations is freed
+                setSummary(block, 0);
+                block = findBlock(minBin);
+            }
+
+            // Grow, a request larger than the block size gets a block of its own
+            block = createBlock(size > m_blockSize ? size : m_blockSize);
+            if (block == NIL)
+                return block_allocation_t();
+
+            block_t&           b = m_blocks[block];
+            const allocation_t a = b.m_allocator->allocate(size, alignment);
+            ASSERT(a.offset != allocation_t::NO_SPACE);
+            b.m_numAllocs++;
+            b.m_emptyFrame = NEVER;
+            updateBlock(block);
+            return {.offset = a.offset, .metadata = a.metadata, .block = block};
+        }
+
+        void offset_allocator_blocks_t::free(block_allocation_t allocation)
+        {
+            ASSERT(allocation.block < m_maxBlocks && m_blocks[allocation.block].m_allocator != nullptr);
+            block_t& b = m_blocks[allocation.block];
+            b.m_allocator->free({.offset = allocation.offset, .metadata = allocation.metadata});
+            if (--b.m_numAllocs == 0)
+                b.m_emptyFrame = m_frame;
+            updateBlock(allocation.block);
+        }
+
+        u32 offset_allocator_blocks_t::allocationSize(block_allocation_t allocation) const
+        {
+            if (allocation.block >= m_maxBlocks || m_blocks[allocation.block].m_allocator == nullptr)
+                return 0;
+            return m_blocks[allocation.block].m_allocator->allocationSize({.offset = allocation.offset, .metadata = allocation.metadata});
+        }
+
+        u32 offset_allocator_blocks_t::releaseEmpty(u64 frame, u32* outBlocks, u32 maxBlocks)
+        {
+            m_frame = frame;
+
+            u32 numReleased = 0;
+            for (u32 i = 0; i < m_maxBlocks && numReleased < maxBlocks; i++)
+            {
+                const block_t& b = m_blocks[i];
+                if (b.m_allocator != nullptr && b.m_numAllocs == 0 && (frame - b.m_emptyFrame) >= m_cooldown)
+                {
+                    releaseBlock(i);
+                    outBlocks[numReleased++] = i;
+                }
+            }
+            return numReleased;
+        }
+
+        u32 offset_allocator_blocks_t::blockSize(u32 block) const
+        {
+            if (block >= m_maxBlocks || m_blocks[block].m_allocator == nullptr)
+                return 0;
+            return m_blocks[block].m_size;
+        }
+
+        u32 offset_allocator_blocks_t::createBlock(u32 size)
+        {
+            for (u32 i = 0; i < m_maxBlocks; i++)
+            {
+                block_t& b = m_blocks[i];
+                if (b.m_allocator == nullptr)
+                {
+                    b.m_allocator = m_allocator->construct<offset_allocator_t>(m_allocator, size, m_maxAllocsPerBlock);
+                    b.m_allocator->setup();
+                    b.m_size       = size;
+                    b.m_numAllocs  = 0;
+                    b.m_emptyFrame = m_frame;
+                    m_numBlocks++;
+                    updateBlock(i);
+                    return i;
+                }
+            }
+            return NIL;
+        }
+
+        void offset_allocator_blocks_t::releaseBlock(u32 block)
+        {
+            block_t& b = m_blocks[block];
+            b.m_allocator->teardown();
+            m_allocator->destruct(b.m_allocator);
+            b.m_allocator = nullptr;
+            b.m_size      = 0;
+            b.m_numAllocs = 0;
+            m_numBlocks--;
+            updateBlock(block);
+        }
+
+        void offset_allocator_blocks_t::updateBlock(u32 block)
+        {
+            u32 value = 0;
+            if (m_blocks[block].m_allocator != nullptr)
+            {
+                const storage_report_t report = m_blocks[block].m_allocator->storageReport();
+                if (report.largestFreeRegion > 0)
+                    value = nfloat::uintToFloatRoundDown(report.largestFreeRegion) + 1;
+            }
+            setSummary(block, value);
+        }
+
+        void offset_allocator_blocks_t::setSummary(u32 block, u32 value)
+        {
+            u32 node     = m_treeLeaves + block;
+            m_tree[node] = value;
+            for (node >>= 1; node > 0; node >>= 1)
+            {
+                const u32 left  = m_tree[node << 1];
+                const u32 right = m_tree[(node << 1) + 1];
+                const u32 max   = left > right ? left : right;
+                if (m_tree[node] == max)
+                    break;
+                m_tree[node] = max;
+            }
+        }
+
+        u32 offset_allocator_blocks_t::findBlock(u32 minBin) const
+        {
+            if (m_tree[1] < minBin)
+                return NIL;
+
+            u32 node = 1;
+            while (node < m_treeLeaves)
+                node = (m_tree[node << 1] >= minBin) ? (node << 1) : (node << 1) + 1;
+            return node - m_treeLeaves;
+        }
+    }  // namespace ngfx
+}  // namespace ncore
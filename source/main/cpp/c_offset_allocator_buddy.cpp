@@ -0,0 +1,204 @@
+#include "cgfxcommon/c_offset_allocator_buddy.h"
+#include "cgfxcommon/c_bit_intrinsics.h"
+
+#include "cbase/c_memory.h"
+#include "cbase/c_allocator.h"
+
+namespace ncore
+{
+    namespace ngfx
+    {
+        offset_allocator_buddy_t::offset_allocator_buddy_t(alloc_t* allocator, u32 size, u32 minBlockSize)
+            : m_allocator(allocator)
+            , m_size(size)
+            , m_minBlockSize(minBlockSize)
+            , m_numLevels(0)
+            , m_usedLevels(0)
+            , m_freeStorage(0)
+            , m_numUsed(0)
+            , m_freeBits(nullptr)
+            , m_next(nullptr)
+            , m_prev(nullptr)
+        {
+            ASSERT(size != 0 && (size & (size - 1)) == 0);                          // Size must be a power of 2
+            ASSERT(minBlockSize != 0 && (minBlockSize & (minBlockSize - 1)) == 0);  // Minimum block size must be a power of 2
+            ASSERT(minBlockSize <= size);
+
+            m_numLevels = tzcnt_nonzero(size / minBlockSize) + 1;
+            ASSERT(m_numLevels <= 26);  // Keeps the free bits below 8 MiB
+        }
+
+        offset_allocator_buddy_t::~offset_allocator_buddy_t() { teardown(); }
+
+        void offset_allocator_buddy_t::setup()
+        {
+            const u32 numUnits = 1u << (m_numLevels - 1);
+            const u32 numWords = ((1u << m_numLevels) + 31) >> 5;
+            m_freeBits         = (u32*)m_allocator->allocate(sizeof(u32) * numWords);
+            m_next             = (u32*)m_allocator->allocate(sizeof(u32) * numUnits);
+            m_prev             = (u32*)m_allocator->allocate(sizeof(u32) * numUnits);
+            reset();
+        }
+
+        void offset_allocator_buddy_t::teardown()
+        {
+            if (m_freeBits)
+            {
+                m_allocator->deallocate(m_freeBits);
+                m_allocator->deallocate(m_next);
+                m_allocator->deallocate(m_prev);
+            }
+            m_freeBits = nullptr;
+            m_next     = nullptr;
+            m_prev     = nullptr;
+        }
+
+        void offset_allocator_buddy_t::reset()
+        {
+            nmem::memset(m_freeBits, 0, sizeof(u32) * (((1u << m_numLevels) + 31) >> 5));
+            for (u32 i = 0; i < 32; i++)
+            {
+                m_freeHeads[i]  = NIL;
+                m_freeCounts[i] = 0;
+            }
+            m_usedLevels  = 0;
+            m_freeStorage = 0;
+            m_numUsed     = 0;
+
+            // Start state: the whole range as one free block
+            pushBlock(0, 0);
+            m_freeStorage = m_size;
+        }
+
+        allocation_t offset_allocator_buddy_t::allocate(u32 size)
+        {
+            if (size > m_size)
+                return {.offset = allocation_t::NO_SPACE, .metadata = allocation_t::NO_SPACE};
+
+            // Deepest level with a block that can hold the allocation
+            u32 level = m_numLevels - 1;
+            u32 block = m_minBlockSize;
+            while (block < size)
+            {
+                block <<= 1;
+                level--;
+            }
+
+            // Smallest free block that fits, the deepest level <= 'level' with a free block
+            const u32 candidates = m_usedLevels & ((2u << level) - 1);
+            if (candidates == 0)
+                return {.offset = allocation_t::NO_SPACE, .metadata = allocation_t::NO_SPACE};
+
+            u32       freeLevel = 31 - lzcnt_nonzero(candidates);
+            const u32 unit      = m_freeHeads[freeLevel];
+            u32       index     = unit >> (m_numLevels - 1 - freeLevel);
+            removeBlock(freeLevel, index);
+
+            // Split down to the requested level, the right halves become free blocks
+            while (freeLevel < level)
+            {
+                freeLevel++;
+                index <<= 1;
+                pushBlock(freeLevel, index + 1);
+            }
+
+            m_freeStorage -= blockSize(level);
+            m_numUsed++;
+            return {.offset = index * blockSize(level), .metadata = level};
+        }
+
+        allocation_t offset_allocator_buddy_t::allocate(u32 size, u32 alignment)
+        {
+            ASSERT(alignment != 0 && (alignment & (alignment - 1)) == 0);  // Alignment must be a power of 2
+
+            // Blocks are aligned to their size
+            return allocate(size < alignment ? alignment : size);
+        }
+
+        void offset_allocator_buddy_t::free(allocation_t allocation)
+        {
+            ASSERT(allocation.metadata != allocation_t::NO_SPACE);
+            if (!m_freeBits)
+                return;
+
+            u32 level = allocation.metadata;
+            u32 index = allocation.offset / blockSize(level);
+            ASSERT(!isFree(nodeIndex(level, index)));  // Double free?
+            m_freeStorage += blockSize(level);
+            m_numUsed--;
+
+            // Merge with the buddy as long as it is free
+            while (level > 0 && isFree(nodeIndex(level, index ^ 1)))
+            {
+                removeBlock(level, index ^ 1);
+                index >>= 1;
+                level--;
+            }
+            pushBlock(level, index);
+        }
+
+        u32 offset_allocator_buddy_t::allocationSize(allocation_t allocation) const
+        {
+            if (allocation.metadata == allocation_t::NO_SPACE)
+                return 0;
+            if (!m_freeBits)
+                return 0;
+            return blockSize(allocation.metadata);
+        }
+
+        storage_report_t offset_allocator_buddy_t::storageReport() const
+        {
+            u32 largestFreeRegion = 0;
+            if (m_usedLevels)
+                largestFreeRegion = blockSize(tzcnt_nonzero(m_usedLevels));
+            return {.totalFreeSpace = m_freeStorage, .largestFreeRegion = largestFreeRegion, .inFlightSpace = 0};
+        }
+
+        fragmentation_report_t offset_allocator_buddy_t::fragmentationReport() const
+        {
+            fragmentation_report_t report = {.freeBlockCount = 0, .usedBlockCount = m_numUsed, .totalFreeSpace = m_freeStorage, .largestFreeBlock = 0, .fragmentation = 0.0f};
+            for (u32 i = 0; i < m_numLevels; i++)
+                report.freeBlockCount += m_freeCounts[i];
+
+            if (m_usedLevels)
+            {
+                report.largestFreeBlock = blockSize(tzcnt_nonzero(m_usedLevels));
+                report.fragmentation    = 1.0f - ((f32)report.largestFreeBlock / (f32)m_freeStorage);
+            }
+            return report;
+        }
+
+        void offset_allocator_buddy_t::pushBlock(u32 level, u32 index)
+        {
+            const u32 node = nodeIndex(level, index);
+            m_freeBits[node >> 5] |= (1u << (node & 31));
+
+            const u32 unit = index << (m_numLevels - 1 - level);
+            m_prev[unit]   = NIL;
+            m_next[unit]   = m_freeHeads[level];
+            if (m_freeHeads[level] != NIL)
+                m_prev[m_freeHeads[level]] = unit;
+            m_freeHeads[level] = unit;
+
+            m_freeCounts[level]++;
+            m_usedLevels |= (1u << level);
+        }
+
+        void offset_allocator_buddy_t::removeBlock(u32 level, u32 index)
+        {
+            const u32 node = nodeIndex(level, index);
+            m_freeBits[node >> 5] &= ~(1u << (node & 31));
+
+            const u32 unit = index << (m_numLevels - 1 - level);
+            if (m_prev[unit] != NIL)
+                m_next[m_prev[unit]] = m_next[unit];
+            else
+                m_freeHeads[level] = m_next[unit];
+            if (m_next[unit] != NIL)
+                m_prev[m_next[unit]] = m_prev[unit];
+
+            if (--m_freeCounts[level] == 0)
+                m_usedLevels &= ~(1u << level);
+        }
+    }  // namespace ngfx
+}  // namespace ncore
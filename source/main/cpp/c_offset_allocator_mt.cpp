@@ -0,0 +1,125 @@
+#include "cgfxcommon/c_offset_allocator_mt.h"
+#include "cgfxcommon/c_offset_allocator_intrinsics.h"
+
+#include "cbase/c_memory.h"
+#include "cbase/c_allocator.h"
+
+namespace ncore
+{
+    namespace ngfx
+    {
+        namespace nfloat
+        {
+            extern u32 uintToFloatRoundUp(u32 size);
+            extern u32 uintToFloatRoundDown(u32 size);
+            extern u32 floatToUint(u32 floatValue);
+        }  // namespace nfloat
+
+        offset_allocator_mt_t::cache_t::cache_t() { nmem::memset(m_count, 0, sizeof(m_count)); }
+
+        offset_allocator_mt_t::offset_allocator_mt_t(alloc_t* allocator, u32 size, u32 maxAllocs)
+            : m_allocator(allocator, size, maxAllocs)
+            , m_lock(0)
+        {
+            ASSERT(nfloat::uintToFloatRoundUp(CACHE_MAX_SIZE) < CACHE_NUM_CLASSES);
+        }
+
+        offset_allocator_mt_t::~offset_allocator_mt_t() {}
+
+        void offset_allocator_mt_t::setup() { m_allocator.setup(); }
+        void offset_allocator_mt_t::teardown() { m_allocator.teardown(); }
+
+        void offset_allocator_mt_t::lock() const { spin_lock(&m_lock); }
+        void offset_allocator_mt_t::unlock() const { spin_unlock(&m_lock); }
+
+        allocation_t offset_allocator_mt_t::allocate(cache_t* cache, u32 size)
+        {
+            if (size > CACHE_MAX_SIZE)
+            {
+                lock();
+                const allocation_t allocation = m_allocator.allocate(size);
+                unlock();
+                return allocation;
+            }
+
+            // Round up to the size class, every range in a class has exactly the class size
+            const u32 sizeClass = nfloat::uintToFloatRoundUp(size);
+            if (cache->m_count[sizeClass] == 0)
+            {
+                // Refill, the batch is carved out of a single node so the ranges are contiguous
+                u32 sizes[CACHE_REFILL];
+                for (u32 i = 0; i < CACHE_REFILL; i++)
+                    sizes[i] = nfloat::floatToUint(sizeClass);
+
+                allocation_t ranges[CACHE_REFILL];
+                lock();
+                m_allocator.allocateMany(sizes, CACHE_REFILL, ranges);
+                unlock();
+
+                // Push in reverse so that the lowest offset is handed out first
+                for (u32 i = CACHE_REFILL; i > 0; --i)
+                {
+                    if (ranges[i - 1].offset != allocation_t::NO_SPACE)
+                        cache->m_ranges[sizeClass][cache->m_count[sizeClass]++] = ranges[i - 1];
+                }
+
+                // Out of space?
+                if (cache->m_count[sizeClass] == 0)
+                    return {.offset = allocation_t::NO_SPACE, .metadata = allocation_t::NO_SPACE};
+            }
+
+            return cache->m_ranges[sizeClass][--cache->m_count[sizeClass]];
+        }
+
+        void offset_allocator_mt_t::free(cache_t* cache, allocation_t allocation)
+        {
+            ASSERT(allocation.metadata != allocation_t::NO_SPACE);
+
+            // The size of a used node is only changed by its owner, so it can be read without the lock
+            const u32 size = m_allocator.allocationSize(allocation);
+            if (size > CACHE_MAX_SIZE)
+            {
+                lock();
+                m_allocator.free(allocation);
+                unlock();
+                return;
+            }
+
+            const u32 sizeClass = nfloat::uintToFloatRoundDown(size);
+            if (cache->m_count[sizeClass] == CACHE_DEPTH)
+            {
+                // Cache is full, return the oldest ranges to the shared allocator in one batch
+                lock();
+                m_allocator.freeMany(cache->m_ranges[sizeClass], CACHE_REFILL);
+                unlock();
+
+                nmem::memmove(cache->m_ranges[sizeClass], cache->m_ranges[sizeClass] + CACHE_REFILL, (CACHE_DEPTH - CACHE_REFILL) * sizeof(allocation_t));
+                cache->m_count[sizeClass] -= CACHE_REFILL;
+            }
+
+            cache->m_ranges[sizeClass][cache->m_count[sizeClass]++] = allocation;
+        }
+
+        void offset_allocator_mt_t::flush(cache_t* cache)
+        {
+            lock();
+            for (u32 i = 0; i < CACHE_NUM_CLASSES; i++)
+            {
+                if (cache->m_count[i] > 0)
+                    m_allocator.freeMany(cache->m_ranges[i], cache->m_count[i]);
+                cache->m_count[i] = 0;
+            }
+            unlock();
+        }
+
+        u32 offset_allocator_mt_t::allocationSize(allocation_t allocation) const { return m_allocator.allocationSize(allocation); }
+
+        storage_report_t offset_allocator_mt_t::storageReport() const
+        {
+            lock();
+            const storage_report_t report = m_allocator.storageReport();
+            unlock();
+            return report;
+        }
+    }  // namespace ngfx
+}  // namespace ncore
@@ -0,0 +1,185 @@
+#include "cgfxcommon/c_offset_allocator_ring.h"
+#include "cgfxcommon/c_offset_allocator_intrinsics.h"
+
+#include "cbase/c_memory.h"
+#include "cbase/c_allocator.h"
+
+namespace ncore
+{
+    namespace ngfx
+    {
+        offset_allocator_ring_t::offset_allocator_ring_t(alloc_t* allocator, offset_allocator_t* backing, u32 size, u32 maxFrames, u32 maxOverflow)
+            : m_allocator(allocator)
+            , m_backing(backing)
+            , m_range()
+            , m_size(size)
+            , m_head(0)
+            , m_ringBytes(0)
+            , m_tail(0)
+            , m_frameStart(0)
+            , m_frames(nullptr)
+            , m_maxFrames(maxFrames)
+            , m_frameHead(0)
+            , m_frameCount(0)
+            , m_overflow(nullptr)
+            , m_maxOverflow(maxOverflow)
+            , m_overflowHead(0)
+            , m_overflowCount(0)
+            , m_overflowOpen(0)
+            , m_overflowBytes(0)
+            , m_overflowTotal(0)
+            , m_highWater(0)
+            , m_backingLock(0)
+        {
+            ASSERT(size > 0 && maxFrames > 0);
+        }
+
+        offset_allocator_ring_t::~offset_allocator_ring_t() { teardown(); }
+
+        void offset_allocator_ring_t::setup()
+        {
+            lockBacking();
+            m_range = m_backing->allocate(m_size, 256);
+            unlockBacking();
+            m_frames   = (frame_t*)m_allocator->allocate(sizeof(frame_t) * m_maxFrames);
+            m_overflow = (allocation_t*)m_allocator->allocate(sizeof(allocation_t) * m_maxOverflow);
+            ASSERT(m_range.offset != allocation_t::NO_SPACE);
+        }
+
+        void offset_allocator_ring_t::teardown()
+        {
+            if (m_frames == nullptr)
+                return;
+
+            // Release the overflow allocations of the closed frames and of the frame being recorded
+            lockBacking();
+            while (m_overflowCount > 0)
+            {
+                m_backing->free(m_overflow[m_overflowHead]);
+                m_overflowHead = (m_overflowHead + 1) % m_maxOverflow;
+                m_overflowCount--;
+            }
+            if (m_range.offset != allocation_t::NO_SPACE)
+                m_backing->free(m_range);
+            unlockBacking();
+
+            m_allocator->deallocate(m_frames);
+            m_allocator->deallocate(m_overflow);
+            m_frames       = nullptr;
+            m_overflow     = nullptr;
+            m_range        = allocation_t();
+            m_head         = 0;
+            m_ringBytes    = 0;
+            m_tail         = 0;
+            m_frameStart   = 0;
+            m_frameHead    = 0;
+            m_frameCount   = 0;
+            m_overflowHead = 0;
+            m_overflowOpen = 0;
+        }
+
+        allocation_t offset_allocator_ring_t::allocate(u32 size, u32 alignment)
+        {
+            ASSERT(alignment != 0 && (alignment & (alignment - 1)) == 0);  // Alignment must be a power of 2
+
+            // Offsets within the ring are aligned in the space of the backing allocator
+            const u32 base = m_range.offset;
+            u64       pos  = atomic_load(&m_head);
+            for (;;)
+            {
+                u64 start      = pos;
+                u32 ringOffset = (u32)(pos % m_size);
+                u32 aligned    = ((base + ringOffset + alignment - 1) & ~(alignment - 1)) - base;
+                if ((u64)aligned + size > m_size)
+                {
+                    // The allocation must not wrap around the end of the ring, skip the rest of the ring
+                    start      = pos + (m_size - ringOffset);
+                    ringOffset = 0;
+                    aligned    = ((base + alignment - 1) & ~(alignment - 1)) - base;
+                    if ((u64)aligned + size > m_size)
+                        break;
+                }
+
+                // Only a successful attempt moves the head, when the ring is full the head stays where it is
+                const u64 end = start + (aligned - ringOffset) + size;
+                if ((end - m_tail) > m_size)
+                    break;
+                if (atomic_compare_exchange(&m_head, pos, end))
+                {
+                    atomic_add(&m_ringBytes, size);
+                    return {.offset = base + aligned, .metadata = RING};
+                }
+            }
+
+            return allocateOverflow(size, alignment);
+        }
+
+        allocation_t offset_allocator_ring_t::allocateOverflow(u32 size, u32 alignment)
+        {
+            allocation_t allocation;
+            lockBacking();
+            if (m_overflowCount < m_maxOverflow)
+            {
+                allocation = m_backing->allocate(size, alignment);
+                if (allocation.offset != allocation_t::NO_SPACE)
+                {
+                    m_overflow[(m_overflowHead + m_overflowCount) % m_maxOverflow] = allocation;
+                    m_overflowCount++;
+                    m_overflowOpen++;
+                    m_overflowBytes += m_backing->allocationSize(allocation);
+                    m_overflowTotal++;
+                }
+            }
+            unlockBacking();
+            return allocation;
+        }
+
+        void offset_allocator_ring_t::endFrame(u64 frame)
+        {
+            ASSERT(m_frameCount < m_maxFrames);  // Too many frames in flight, retire first
+            ASSERT(m_frameCount == 0 || m_frames[(m_frameHead + m_frameCount - 1) % m_maxFrames].m_frame < frame);
+
+            // Only the bytes of placed allocations count, not the alignment padding or the skipped end of the ring
+            const u64 end  = m_head;
+            const u32 used = (u32)m_ringBytes + m_overflowBytes;
+            if (used > m_highWater)
+                m_highWater = used;
+
+            frame_t& f   = m_frames[(m_frameHead + m_frameCount) % m_maxFrames];
+            f.m_frame    = frame;
+            f.m_end      = end;
+            f.m_overflow = m_overflowOpen;
+            m_frameCount++;
+
+            m_frameStart    = end;
+            m_ringBytes     = 0;
+            m_overflowOpen  = 0;
+            m_overflowBytes = 0;
+        }
+
+        u32 offset_allocator_ring_t::retire(u64 frame)
+        {
+            u32 numRetired = 0;
+            lockBacking();
+            while (m_frameCount > 0 && m_frames[m_frameHead].m_frame <= frame)
+            {
+                const frame_t& f = m_frames[m_frameHead];
+                m_tail           = f.m_end;
+                for (u32 i = 0; i < f.m_overflow; i++)
+                {
+                    m_backing->free(m_overflow[m_overflowHead]);
+                    m_overflowHead = (m_overflowHead + 1) % m_maxOverflow;
+                    m_overflowCount--;
+                }
+                m_frameHead = (m_frameHead + 1) % m_maxFrames;
+                m_frameCount--;
+                numRetired++;
+            }
+            unlockBacking();
+            return numRetired;
+        }
+
+        void offset_allocator_ring_t::lockBacking() { spin_lock(&m_backingLock); }
+        void offset_allocator_ring_t::unlockBacking() { spin_unlock(&m_backingLock); }
+    }  // namespace ngfx
+}  // namespace ncore
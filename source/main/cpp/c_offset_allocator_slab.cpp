@@ -0,0 +1,206 @@
+#include "cgfxcommon/c_offset_allocator_slab.h"
+#include "cgfxcommon/c_bit_intrinsics.h"
+
+#include "cbase/c_memory.h"
+#include "cbase/c_allocator.h"
+
+namespace ncore
+{
+    namespace ngfx
+    {
+        offset_allocator_slab_t::offset_allocator_slab_t(alloc_t* allocator, offset_allocator_t* parent, u32 maxPages)
+            : m_allocator(allocator)
+            , m_parent(parent)
+            , m_pages(nullptr)
+            , m_maxPages(maxPages)
+            , m_numPages(0)
+            , m_pageIndex(0)
+            , m_freePageHead(NIL)
+        {
+            ASSERT(maxPages < (1 << 23));  // Page index and block index (8 bits) are stored in the metadata
+            ASSERT((PAGE_SIZE / CLASS_SIZE) <= 256);
+            for (u32 i = 0; i < NUM_CLASSES; i++)
+                m_partial[i] = NIL;
+        }
+
+        offset_allocator_slab_t::~offset_allocator_slab_t()
+        {
+            if (m_pages)
+                m_allocator->deallocate(m_pages);
+        }
+
+        void offset_allocator_slab_t::setup() { m_pages = (page_t*)m_allocator->allocate(sizeof(page_t) * m_maxPages); }
+
+        void offset_allocator_slab_t::teardown()
+        {
+            if (m_pages)
+            {
+                for (u32 i = 0; i < NUM_CLASSES; i++)
+                {
+                    while (m_partial[i] != NIL)
+                        releasePage(m_partial[i]);
+                }
+
+                // Pages without a free block are not in a partial list
+                for (u32 i = 0; i < m_pageIndex; i++)
+                {
+                    if (m_pages[i].m_range.offset != allocation_t::NO_SPACE)
+                        m_parent->free(m_pages[i].m_range);
+                }
+
+                m_allocator->deallocate(m_pages);
+            }
+
+            m_pages        = nullptr;
+            m_numPages     = 0;
+            m_pageIndex    = 0;
+            m_freePageHead = NIL;
+            for (u32 i = 0; i < NUM_CLASSES; i++)
+                m_partial[i] = NIL;
+        }
+
+        allocation_t offset_allocator_slab_t::allocate(u32 size)
+        {
+            if (size > MAX_SIZE)
+                return m_parent->allocate(size);
+
+            const u32 sizeClass = size == 0 ? 0 : (size - 1) / CLASS_SIZE;
+
+            u32 pageIndex = m_partial[sizeClass];
+            if (pageIndex == NIL)
+            {
+                pageIndex = allocatePage(sizeClass);
+                if (pageIndex == NIL)
+                    return m_parent->allocate(size);
+            }
+
+            page_t& page = m_pages[pageIndex];
+            u32     word = 0;
+            while (page.m_free[word] == 0)
+                word++;
+            const u32 bit   = tzcnt_nonzero(page.m_free[word]);
+            const u32 block = (word << 5) | bit;
+            page.m_free[word] &= ~(1u << bit);
+
+            // Page full, remove it from the partial list
+            if (--page.m_numFree == 0)
+                unlinkPage(pageIndex);
+
+            return {.offset = page.m_range.offset + block * (sizeClass + 1) * CLASS_SIZE, .metadata = SLAB_BIT | (pageIndex << 8) | block};
+        }
+
+        void offset_allocator_slab_t::free(allocation_t allocation)
+        {
+            ASSERT(allocation.metadata != allocation_t::NO_SPACE);
+            if ((allocation.metadata & SLAB_BIT) == 0)
+            {
+                m_parent->free(allocation);
+                return;
+            }
+
+            const u32 pageIndex = (allocation.metadata & ~SLAB_BIT) >> 8;
+            const u32 block     = allocation.metadata & 0xff;
+            page_t&   page      = m_pages[pageIndex];
+            ASSERT((page.m_free[block >> 5] & (1u << (block & 31))) == 0);  // Double free?
+            page.m_free[block >> 5] |= (1u << (block & 31));
+
+            // Page was full, it has a free block again
+            if (page.m_numFree++ == 0)
+                linkPage(pageIndex);
+
+            // Page empty, give it back to the parent
+            if (page.m_numFree == page.m_numBlocks)
+                releasePage(pageIndex);
+        }
+
+        u32 offset_allocator_slab_t::allocationSize(allocation_t allocation) const
+        {
+            if (allocation.metadata == allocation_t::NO_SPACE)
+                return 0;
+            if ((allocation.metadata & SLAB_BIT) == 0)
+                return m_parent->allocationSize(allocation);
+
+            const u32 pageIndex = (allocation.metadata & ~SLAB_BIT) >> 8;
+            return (m_pages[pageIndex].m_class + 1) * CLASS_SIZE;
+        }
+
+        u32 offset_allocator_slab_t::allocatePage(u32 sizeClass)
+        {
+            // Out of page records?
+            if (m_freePageHead == NIL && m_pageIndex == m_maxPages)
+                return NIL;
+
+            const allocation_t range = m_parent->allocate(PAGE_SIZE, PAGE_ALIGNMENT);
+            if (range.offset == allocation_t::NO_SPACE)
+                return NIL;
+
+            u32 pageIndex;
+            if (m_freePageHead != NIL)
+            {
+                pageIndex      = m_freePageHead;
+                m_freePageHead = m_pages[pageIndex].m_next;
+            }
+            else
+            {
+                pageIndex = m_pageIndex++;
+            }
+
+            const u32 numBlocks = PAGE_SIZE / ((sizeClass + 1) * CLASS_SIZE);
+
+            page_t& page     = m_pages[pageIndex];
+            page.m_range     = range;
+            page.m_numFree   = (u16)numBlocks;
+            page.m_numBlocks = (u16)numBlocks;
+            page.m_class     = sizeClass;
+            for (u32 i = 0; i < PAGE_WORDS; i++)
+            {
+                const u32 first = i << 5;
+                if (numBlocks >= (first + 32))
+                    page.m_free[i] = 0xffffffff;
+                else if (numBlocks > first)
+                    page.m_free[i] = (1u << (numBlocks - first)) - 1;
+                else
+                    page.m_free[i] = 0;
+            }
+
+            linkPage(pageIndex);
+            m_numPages++;
+            return pageIndex;
+        }
+
+        void offset_allocator_slab_t::releasePage(u32 pageIndex)
+        {
+            page_t& page = m_pages[pageIndex];
+            unlinkPage(pageIndex);
+            m_parent->free(page.m_range);
+
+            page.m_range   = allocation_t();
+            page.m_next    = m_freePageHead;
+            m_freePageHead = pageIndex;
+            m_numPages--;
+        }
+
+        void offset_allocator_slab_t::linkPage(u32 pageIndex)
+        {
+            page_t& page = m_pages[pageIndex];
+            page.m_prev  = NIL;
+            page.m_next  = m_partial[page.m_class];
+            if (page.m_next != NIL)
+                m_pages[page.m_next].m_prev = pageIndex;
+            m_partial[page.m_class] = pageIndex;
+        }
+
+        void offset_allocator_slab_t::unlinkPage(u32 pageIndex)
+        {
+            page_t& page = m_pages[pageIndex];
+            if (page.m_prev != NIL)
+                m_pages[page.m_prev].m_next = page.m_next;
+            else
+                m_partial[page.m_class] = page.m_next;
+            if (page.m_next != NIL)
+                m_pages[page.m_next].m_prev = page.m_prev;
+            page.m_prev = NIL;
+            page.m_next = NIL;
+        }
+    }  // namespace ngfx
+}  // namespace ncore
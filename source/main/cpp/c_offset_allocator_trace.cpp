@@ -0,0 +1,277 @@
+#include "cgfxcommon/c_offset_allocator_trace.h"
+#include "cgfxcommon/c_offset_allocator_buddy.h"
+
+#include "cbase/c_memory.h"
+#include "cbase/c_allocator.h"
+
+#ifdef _MSC_VER
+#    ifndef WIN32_LEAN_AND_MEAN
+#        define WIN32_LEAN_AND_MEAN
+#    endif
+#    ifndef NOMINMAX
+#        define NOMINMAX
+#    endif
+#    include <windows.h>
+#else
+#    include <time.h>
+#endif
+
+namespace ncore
+{
+    namespace ngfx
+    {
+        namespace nfloat
+        {
+            extern u32 uintToFloatRoundUp(u32 size);
+            extern u32 floatToUint(u32 floatValue);
+        }  // namespace nfloat
+
+        static u64 trace_clock_ns()
+        {
+#ifdef _MSC_VER
+            static LARGE_INTEGER frequency = {};
+            if (frequency.QuadPart == 0)
+                QueryPerformanceFrequency(&frequency);
+            LARGE_INTEGER counter;
+            QueryPerformanceCounter(&counter);
+            const u64 f = (u64)frequency.QuadPart;
+            const u64 c = (u64)counter.QuadPart;
+            return (c / f) * 1000000000ull + ((c % f) * 1000000000ull) / f;
+#else
+            struct timespec ts;
+            clock_gettime(CLOCK_MONOTONIC, &ts);
+            return (u64)ts.tv_sec * 1000000000ull + (u64)ts.tv_nsec;
+#endif
+        }
+
+        // Trace blob: header followed by the events
+        static constexpr u32 TRACE_MAGIC   = 0x4352544f;  // 'OTRC'
+        static constexpr u32 TRACE_VERSION = 2;
+
+        struct trace_header_t
+        {
+            u32 magic;
+            u32 version;
+            u32 numEvents;
+            u32 numIds;
+        };
+
+        offset_allocator_trace_t::offset_allocator_trace_t(alloc_t* allocator, offset_allocator_t* target, u32 maxEvents)
+            : m_allocator(allocator)
+            , m_target(target)
+            , m_events(nullptr)
+            , m_ids(nullptr)
+            , m_maxEvents(maxEvents)
+            , m_numIdSlots(0)
+            , m_numEvents(0)
+            , m_numIds(0)
+            , m_lastTime(0)
+        {
+        }
+
+        offset_allocator_trace_t::~offset_allocator_trace_t() { teardown(); }
+
+        void offset_allocator_trace_t::setup()
+        {
+            m_events     = (trace_event_t*)m_allocator->allocate(sizeof(trace_event_t) * m_maxEvents);
+            m_numIdSlots = m_target->capacity();
+            m_ids        = (u32*)m_allocator->allocate(sizeof(u32) * m_numIdSlots);
+            m_numEvents  = 0;
+            m_numIds     = 0;
+            m_lastTime   = trace_clock_ns();
+        }
+
+        void offset_allocator_trace_t::teardown()
+        {
+            if (m_events)
+            {
+                m_allocator->deallocate(m_events);
+                m_allocator->deallocate(m_ids);
+            }
+            m_events     = nullptr;
+            m_ids        = nullptr;
+            m_numIdSlots = 0;
+            m_numEvents  = 0;
+            m_numIds    = 0;
+        }
+
+        allocation_t offset_allocator_trace_t::allocate(u32 size)
+        {
+            const allocation_t allocation = m_target->allocate(size);
+            if (allocation.metadata != allocation_t::NO_SPACE)
+                trackId(allocation.metadata, m_numIds);
+            record(m_numIds++, size, allocation.offset);
+            return allocation;
+        }
+
+        allocation_t offset_allocator_trace_t::allocate(u32 size, u32 alignment)
+        {
+            const allocation_t allocation = m_target->allocate(size, alignment);
+            if (allocation.metadata != allocation_t::NO_SPACE)
+                trackId(allocation.metadata, m_numIds);
+            record(m_numIds++, size, allocation.offset, alignment);
+            return allocation;
+        }
+
+        void offset_allocator_trace_t::free(allocation_t allocation)
+        {
+            ASSERT(allocation.metadata < m_numIdSlots);
+            m_target->free(allocation);
+            record(m_ids[allocation.metadata] | trace_event_t::FREE, 0, allocation.offset);
+        }
+
+        void offset_allocator_trace_t::trackId(u32 nodeIndex, u32 id)
+        {
+            // The target may have grown its capacity (growCapacity) since setup
+            if (nodeIndex >= m_numIdSlots)
+            {
+                const u32 numIdSlots = m_target->capacity();
+                ASSERT(nodeIndex < numIdSlots);
+                u32* ids = (u32*)m_allocator->allocate(sizeof(u32) * numIdSlots);
+                nmem::memcpy(ids, m_ids, sizeof(u32) * m_numIdSlots);
+                m_allocator->deallocate(m_ids);
+                m_ids        = ids;
+                m_numIdSlots = numIdSlots;
+            }
+            m_ids[nodeIndex] = id;
+        }
+
+        void offset_allocator_trace_t::record(u32 id, u32 size, u32 offset, u32 alignment)
+        {
+            if (m_numEvents == m_maxEvents)
+                return;
+
+            const u64 now   = trace_clock_ns();
+            const u64 delta = now - m_lastTime;
+            m_lastTime      = now;
+
+            trace_event_t& e = m_events[m_numEvents++];
+            e.time           = delta > 0xffffffff ? 0xffffffff : (u32)delta;
+            e.id             = id;
+            e.size           = size;
+            e.offset         = offset;
+            e.alignment      = alignment;
+        }
+
+        u64 offset_allocator_trace_t::traceSize() const { return sizeof(trace_header_t) + (u64)sizeof(trace_event_t) * m_numEvents; }
+
+        bool offset_allocator_trace_t::saveTrace(void* buffer, u64 bufferSize) const
+        {
+            if (bufferSize < traceSize())
+                return false;
+
+            trace_header_t* header = (trace_header_t*)buffer;
+            header->magic          = TRACE_MAGIC;
+            header->version        = TRACE_VERSION;
+            header->numEvents      = m_numEvents;
+            header->numIds         = m_numIds;
+            nmem::memcpy(header + 1, m_events, sizeof(trace_event_t) * m_numEvents);
+            return true;
+        }
+
+        trace_event_t const* offset_allocator_trace_t::readTrace(void const* buffer, u64 bufferSize, u32& outNumEvents, u32& outNumIds)
+        {
+            trace_header_t const* header = (trace_header_t const*)buffer;
+            if (bufferSize < sizeof(trace_header_t) || header->magic != TRACE_MAGIC || header->version != TRACE_VERSION)
+                return nullptr;
+            if (bufferSize < sizeof(trace_header_t) + (u64)sizeof(trace_event_t) * header->numEvents)
+                return nullptr;
+
+            outNumEvents = header->numEvents;
+            outNumIds    = header->numIds;
+            return (trace_event_t const*)(header + 1);
+        }
+
+        template <typename A>
+        u32 replayTrace(A* allocator, alloc_t* scratch, trace_event_t const* events, u32 numEvents, u32 numIds, trace_replay_report_t& outReport, f32* outFragmentation, u32 maxSamples, u32 sampleInterval)
+        {
+            static constexpr u32 NUM_BINS = 256;
+
+            allocation_t* live      = (allocation_t*)scratch->allocate(sizeof(allocation_t) * (numIds > 0 ? numIds : 1));
+            u32*          histogram = (u32*)scratch->allocate(sizeof(u32) * NUM_BINS);
+            for (u32 i = 0; i < numIds; i++)
+                live[i] = allocation_t();
+            nmem::memset(histogram, 0, sizeof(u32) * NUM_BINS);
+
+            outReport       = {.numAllocs = 0, .numFrees = 0, .numFailed = 0, .numMoved = 0, .peakNodes = 0, .p50 = 0, .p90 = 0, .p99 = 0, .max = 0};
+            u32 numSamples  = 0;
+            u32 numTimedOps = 0;
+            for (u32 i = 0; i < numEvents; i++)
+            {
+                trace_event_t const& e = events[i];
+                u64                  elapsed;
+                if ((e.id & trace_event_t::FREE) == 0)
+                {
+                    // Allocations that failed while recording did not change the heap
+                    if (e.offset == allocation_t::NO_SPACE)
+                        continue;
+
+                    const u64          begin      = trace_clock_ns();
+                    const allocation_t allocation = (e.alignment != 0) ? allocator->allocate(e.size, e.alignment) : allocator->allocate(e.size);
+                    elapsed                       = trace_clock_ns() - begin;
+
+                    live[e.id] = allocation;
+                    outReport.numAllocs++;
+                    if (allocation.offset == allocation_t::NO_SPACE)
+                        outReport.numFailed++;
+                    else if (allocation.offset != e.offset)
+                        outReport.numMoved++;
+                }
+                else
+                {
+                    const u32 id = e.id & ~trace_event_t::FREE;
+                    if (live[id].offset == allocation_t::NO_SPACE)
+                        continue;
+
+                    const u64 begin = trace_clock_ns();
+                    allocator->free(live[id]);
+                    elapsed = trace_clock_ns() - begin;
+
+                    live[id] = allocation_t();
+                    outReport.numFrees++;
+                }
+
+                const u32 ns  = elapsed > 0x7fffffff ? 0x7fffffff : (u32)elapsed;
+                const u32 bin = nfloat::uintToFloatRoundUp(ns);
+                histogram[bin < NUM_BINS ? bin : NUM_BINS - 1]++;
+                numTimedOps++;
+                if (ns > outReport.max)
+                    outReport.max = ns;
+
+                const fragmentation_report_t report = allocator->fragmentationReport();
+                const u32                    nodes  = report.freeBlockCount + report.usedBlockCount;
+                if (nodes > outReport.peakNodes)
+                    outReport.peakNodes = nodes;
+
+                if (outFragmentation != nullptr && numSamples < maxSamples && (i % sampleInterval) == 0)
+                    outFragmentation[numSamples++] = report.fragmentation;
+            }
+
+            // Percentiles from the histogram
+            const u32 targets[3] = {(numTimedOps * 50 + 99) / 100, (numTimedOps * 90 + 99) / 100, (numTimedOps * 99 + 99) / 100};
+            u32*      results[3] = {&outReport.p50, &outReport.p90, &outReport.p99};
+            u32       count      = 0;
+            u32       target     = 0;
+            for (u32 bin = 0; bin < NUM_BINS && target < 3; bin++)
+            {
+                count += histogram[bin];
+                while (target < 3 && count >= targets[target] && count > 0)
+                    *results[target++] = nfloat::floatToUint(bin);
+            }
+
+            // Give back what the trace did not free
+            for (u32 i = 0; i < numIds; i++)
+            {
+                if (live[i].offset != allocation_t::NO_SPACE)
+                    allocator->free(live[i]);
+            }
+
+            scratch->deallocate(histogram);
+            scratch->deallocate(live);
+            return numSamples;
+        }
+
+        template u32 replayTrace<offset_allocator_t>(offset_allocator_t*, alloc_t*, trace_event_t const*, u32, u32, trace_replay_report_t&, f32*, u32, u32);
+        template u32 replayTrace<offset_allocator_buddy_t>(offset_allocator_buddy_t*, alloc_t*, trace_event_t const*, u32, u32, trace_replay_report_t&, f32*, u32, u32);
+    }  // namespace ngfx
+}  // namespace ncore
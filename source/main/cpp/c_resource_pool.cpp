@@ -2,6 +2,12 @@
 #include "cbase/c_integer.h"
 #include "cbase/c_memory.h"
 #include "cgfxcommon/c_resource_pool.h"
+#include "cgfxcommon/c_bit_intrinsics.h"
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#    include <emmintrin.h>
+#    define C_RESOURCE_POOL_SSE2
+#endif
 
 namespace ncore
 {
@@ -13,6 +19,10 @@ namespace ncore
                 : m_memory(nullptr)
                 , m_num_max(0)
                 , m_sizeof(0)
+                , m_pages(nullptr)
+                , m_page_shift(0)
+                , m_page_mask(0)
+                , m_allocator(nullptr)
             {
             }
 
@@ -26,7 +36,89 @@ namespace ncore
                 m_sizeof  = sizeof_resource;
             }
 
-            void array_t::teardown(alloc_t* allocator) { allocator->deallocate(m_memory); }
+            void array_t::setup_chunked(alloc_t* allocator, u32 max_num_resources, u32 sizeof_resource, u32 page_shift)
+            {
+                ASSERT(sizeof_resource >= sizeof(u32));  // Resource size must be at least the size of a u32 since we use it as a linked list.
+                ASSERT(page_shift < 32);
+
+                m_num_max    = max_num_resources;
+                m_sizeof     = sizeof_resource;
+                m_page_shift = page_shift;
+                m_page_mask  = (1u << page_shift) - 1;
+                m_allocator  = allocator;
+                m_pages      = (byte**)g_allocate_and_clear(allocator, ((max_num_resources + m_page_mask) >> page_shift) * sizeof(byte*));
+            }
+
+            void array_t::teardown(alloc_t* allocator)
+            {
+                if (m_pages != nullptr)
+                {
+                    u32 const n = num_pages();
+                    for (u32 i = 0; i < n; ++i)
+                    {
+                        if (m_pages[i] != nullptr)
+                            allocator->deallocate(m_pages[i]);
+                    }
+                    allocator->deallocate(m_pages);
+                    m_pages = nullptr;
+                }
+                else
+                {
+                    allocator->deallocate(m_memory);
+                }
+                m_memory = nullptr;
+            }
+
+            void array_t::commit_page(u32 page)
+            {
+                ASSERT(page < num_pages());
+                m_pages[page] = (byte*)m_allocator->allocate((m_page_mask + 1) * m_sizeof);
+                ASSERTS(m_pages[page] != nullptr, "Error: out of memory for a page of the array!");
+            }
+
+            // ------------------------------------------------------------------------------------------------
+
+            bool used_iterator_t::refill()
+            {
+                m_pos   = 0;
+                m_count = 0;
+                while (m_word_index < m_num_words)
+                {
+                    // Skip empty regions, 8 words at once
+                    while ((m_word_index + 8) <= m_num_words)
+                    {
+                        u32 const* w = m_bits + m_word_index;
+#ifdef C_RESOURCE_POOL_SSE2
+                        __m128i const any = _mm_or_si128(_mm_loadu_si128((__m128i const*)w), _mm_loadu_si128((__m128i const*)(w + 4)));
+                        if (_mm_movemask_epi8(_mm_cmpeq_epi32(any, _mm_setzero_si128())) != 0xFFFF)
+                            break;
+#else
+                        if ((w[0] | w[1] | w[2] | w[3] | w[4] | w[5] | w[6] | w[7]) != 0)
+                            break;
+#endif
+                        m_word_index += 8;
+                    }
+                    if (m_word_index >= m_num_words)
+                        break;
+
+                    u32 const base = m_word_index << 5;
+                    u64       word = m_bits[m_word_index];
+                    if ((m_word_index + 1) < m_num_words)
+                        word |= (u64)m_bits[m_word_index + 1] << 32;
+                    if ((m_num_bits - base) < 64)
+                        word &= ((u64)1 << (m_num_bits - base)) - 1;
+                    m_word_index += 2;
+
+                    while (word != 0)
+                    {
+                        m_indices[m_count++] = base + tzcnt_nonzero(word);
+                        word &= word - 1;
+                    }
+                    if (m_count > 0)
+                        return true;
+                }
+                return false;
+            }
 
             // ------------------------------------------------------------------------------------------------
 
@@ -42,6 +134,12 @@ namespace ncore
                 m_bitarray = (u32*)g_allocate_and_clear(allocator, ((max_num_resources + 31) / 32) * sizeof(u32));
             }
 
+            void inventory_t::setup_chunked(alloc_t* allocator, u32 max_num_resources, u32 sizeof_resource, u32 page_shift)
+            {
+                m_array.setup_chunked(allocator, max_num_resources, sizeof_resource, page_shift);
+                m_bitarray = (u32*)g_allocate_and_clear(allocator, ((max_num_resources + 31) / 32) * sizeof(u32));
+            }
+
             void inventory_t::teardown(alloc_t* allocator)
             {
                 m_array.teardown(allocator);
@@ -50,48 +148,292 @@ namespace ncore
 
             void inventory_t::free_all() { nmem::memset(m_bitarray, 0, ((m_array.m_num_max + 31) / 32) * sizeof(u32)); }
 
+            // ------------------------------------------------------------------------------------------------
+
+            used_map_t::used_map_t()
+                : m_num_levels(0)
+                , m_count(0)
+            {
+                for (u32 i = 0; i < MAX_LEVELS; ++i)
+                    m_levels[i] = nullptr;
+            }
+
+            void used_map_t::setup(alloc_t* allocator, u32 count)
+            {
+                ASSERT(count > 0);
+
+                // Level 0 has a bit per index, every next level a bit per word of the level below, up to a single word
+                u32 total = 0;
+                u32 bits  = count;
+                m_num_levels = 0;
+                do
+                {
+                    bits = (bits + 31) >> 5;
+                    total += bits;
+                    m_num_levels++;
+                } while (bits > 1);
+
+                u32* words = (u32*)allocator->allocate(total * sizeof(u32));
+                bits       = count;
+                for (u32 level = 0; level < m_num_levels; ++level)
+                {
+                    m_levels[level] = words;
+                    bits            = (bits + 31) >> 5;
+                    words += bits;
+                }
+                m_count = count;
+                clear();
+            }
+
+            void used_map_t::teardown(alloc_t* allocator)
+            {
+                allocator->deallocate(m_levels[0]);
+                for (u32 i = 0; i < MAX_LEVELS; ++i)
+                    m_levels[i] = nullptr;
+                m_num_levels = 0;
+                m_count      = 0;
+            }
+
+            void used_map_t::clear()
+            {
+                // The bits beyond the last index of a level are marked used, a word is never full because of them alone
+                u32 bits = m_count;
+                for (u32 level = 0; level < m_num_levels; ++level)
+                {
+                    u32 const num_words = (bits + 31) >> 5;
+                    nmem::memset(m_levels[level], 0, num_words * sizeof(u32));
+                    if (bits & 31)
+                        m_levels[level][num_words - 1] = ~((1u << (bits & 31)) - 1);
+                    bits = num_words;
+                }
+            }
+
+            void used_map_t::set_bits(u32 level, u32 word, u32 mask)
+            {
+                for (; level < m_num_levels; ++level)
+                {
+                    u32& w = m_levels[level][word];
+                    w |= mask;
+                    if (w != 0xFFFFFFFF)
+                        return;
+                    mask = 1u << (word & 31);
+                    word >>= 5;
+                }
+            }
+
+            void used_map_t::clear_bits(u32 level, u32 word, u32 mask)
+            {
+                for (; level < m_num_levels; ++level)
+                {
+                    u32&       w        = m_levels[level][word];
+                    bool const was_full = (w == 0xFFFFFFFF);
+                    w &= ~mask;
+                    if (!was_full)
+                        return;
+                    mask = 1u << (word & 31);
+                    word >>= 5;
+                }
+            }
+
+            s32 used_map_t::find_free_word() const
+            {
+                u32 const top = m_num_levels - 1;
+                if (m_levels[top][0] == 0xFFFFFFFF)
+                    return -1;
+                u32 word = 0;
+                for (u32 level = top; level > 0; --level)
+                    word = (word << 5) + tzcnt_nonzero(~m_levels[level][word]);
+                return (s32)word;
+            }
+
+            s32 used_map_t::find_and_set()
+            {
+                s32 const word = find_free_word();
+                if (word < 0)
+                    return -1;
+                u32 const index = ((u32)word << 5) + tzcnt_nonzero(~m_levels[0][word]);
+                set_used(index);
+                return (s32)index;
+            }
+
             // ------------------------------------------------------------------------------------------------
             pool_t::pool_t()
                 : m_object_array()
-                , m_free_resource_map()
+                , m_used_map()
             {
             }
 
             void pool_t::setup(array_t* object_array, alloc_t* allocator)
             {
                 m_object_array = object_array;
-                m_free_resource_map.init_all_free(object_array->m_num_max, allocator);
+                m_used_map.setup(allocator, object_array->m_num_max);
             }
 
             void pool_t::teardown(alloc_t* allocator)
             {
                 m_object_array = nullptr;
-                m_free_resource_map.release(allocator);
+                m_used_map.teardown(allocator);
             }
 
-            void pool_t::free_all() { m_free_resource_map.init_all_free(); }
+            void pool_t::free_all() { m_used_map.clear(); }
 
             u32 pool_t::allocate()
             {
-                s32 const index = m_free_resource_map.find_and_set();
+                s32 const index = m_used_map.find_and_set();
                 ASSERTS(index >= 0, "Error: no more resources left!");
+                m_object_array->commit(index);
                 return index;
             }
 
-            void pool_t::deallocate(u32 index) { m_free_resource_map.set_free(index); }
+            void pool_t::deallocate(u32 index)
+            {
+                ASSERT(m_used_map.is_used(index));
+                m_used_map.set_free(index);
+            }
+
+            u32 pool_t::allocate_many(u32 count, u32* out_indices)
+            {
+                u32 n = 0;
+                while (n < count)
+                {
+                    // The upper levels of the used map lead to the lowest word with a free bit, full words are never read
+                    s32 const w = m_used_map.find_free_word();
+                    if (w < 0)
+                        break;
+
+                    // Take all free bits of the word, or the lowest ones that are still needed
+                    u32 free = ~m_used_map.word(w);
+                    u32 take = free;
+                    if ((count - n) < 32)
+                    {
+                        take = 0;
+                        for (u32 num = n; free != 0 && num < count; ++num)
+                        {
+                            take |= free & (0 - free);
+                            free &= free - 1;
+                        }
+                    }
+
+                    m_used_map.set_word_used(w, take);
+                    while (take != 0)
+                    {
+                        u32 const index = ((u32)w << 5) + tzcnt_nonzero(take);
+                        m_object_array->commit(index);
+                        out_indices[n++] = index;
+                        take &= take - 1;
+                    }
+                }
+                return n;
+            }
+
+            void pool_t::deallocate_many(u32 const* indices, u32 count)
+            {
+                u32 i = 0;
+                while (i < count)
+                {
+                    // Gather the indices that share a word, one update of the used map for the word
+                    u32 const w    = indices[i] >> 5;
+                    u32       mask = 0;
+                    for (; i < count && (indices[i] >> 5) == w; ++i)
+                    {
+                        ASSERT(m_used_map.is_used(indices[i]));
+                        mask |= (1u << (indices[i] & 31));
+                    }
+                    m_used_map.set_word_free(w, mask);
+                }
+            }
 
             void* pool_t::get_access(u32 index)
             {
                 ASSERT(index != c_invalid_handle);
-                ASSERTS(m_free_resource_map.is_used(index), "Error: resource is not marked as being in use!");
-                return &m_object_array->m_memory[index * m_object_array->m_sizeof];
+                ASSERTS(m_used_map.is_used(index), "Error: resource is not marked as being in use!");
+                return m_object_array->get_access(index);
             }
 
             const void* pool_t::get_access(u32 index) const
             {
                 ASSERT(index != c_invalid_handle);
-                ASSERTS(m_free_resource_map.is_used(index), "Error: resource is not marked as being in use!");
-                return &m_object_array->m_memory[index * m_object_array->m_sizeof];
+                ASSERTS(m_used_map.is_used(index), "Error: resource is not marked as being in use!");
+                return m_object_array->get_access(index);
+            }
+
+            // ------------------------------------------------------------------------------------------------
+            dense_pool_t::dense_pool_t()
+                : m_object_array(nullptr)
+                , m_sparse(nullptr)
+                , m_dense(nullptr)
+                , m_size(0)
+            {
+            }
+
+            void dense_pool_t::setup(array_t* object_array, alloc_t* allocator)
+            {
+                m_object_array = object_array;
+                m_sparse       = (u32*)allocator->allocate(object_array->m_num_max * sizeof(u32));
+                m_dense        = (u32*)allocator->allocate(object_array->m_num_max * sizeof(u32));
+                free_all();
+            }
+
+            void dense_pool_t::teardown(alloc_t* allocator)
+            {
+                allocator->deallocate(m_sparse);
+                allocator->deallocate(m_dense);
+                m_object_array = nullptr;
+                m_sparse       = nullptr;
+                m_dense        = nullptr;
+                m_size         = 0;
+            }
+
+            void dense_pool_t::free_all()
+            {
+                for (u32 i = 0; i < m_object_array->m_num_max; ++i)
+                {
+                    m_sparse[i] = i;
+                    m_dense[i]  = i;
+                }
+                m_size = 0;
+            }
+
+            u32 dense_pool_t::allocate()
+            {
+                ASSERTS(m_size < m_object_array->m_num_max, "Error: no more resources left!");
+
+                // The first free handle is the one right after the live range
+                m_object_array->commit(m_size);
+                const u32 index = m_dense[m_size];
+                m_sparse[index] = m_size;
+                m_size++;
+                return index;
+            }
+
+            void dense_pool_t::deallocate(u32 index)
+            {
+                ASSERTS(is_used(index), "Error: resource is not marked as being in use!");
+
+                // Move the last live object into the hole and swap the handles, the freed handle ends up right after the live range
+                const u32 dense      = m_sparse[index];
+                const u32 last       = m_size - 1;
+                const u32 last_index = m_dense[last];
+                if (dense != last)
+                    nmem::memcpy(m_object_array->get_access(dense), m_object_array->get_access(last), m_object_array->m_sizeof);
+
+                m_dense[dense]       = last_index;
+                m_sparse[last_index] = dense;
+                m_dense[last]        = index;
+                m_sparse[index]      = last;
+                m_size               = last;
+            }
+
+            void* dense_pool_t::get_access(u32 index)
+            {
+                ASSERTS(is_used(index), "Error: resource is not marked as being in use!");
+                return m_object_array->get_access(m_sparse[index]);
+            }
+
+            const void* dense_pool_t::get_access(u32 index) const
+            {
+                ASSERTS(is_used(index), "Error: resource is not marked as being in use!");
+                return m_object_array->get_access(m_sparse[index]);
             }
         }  // namespace nobject
 
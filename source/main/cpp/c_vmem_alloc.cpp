@@ -0,0 +1,286 @@
+#include "cgfxcommon/c_vmem_alloc.h"
+#include "cgfxcommon/c_resource_pool.h"
+#include "cgfxcommon/c_bit_intrinsics.h"
+
+#include "cbase/c_allocator.h"
+#include "cbase/c_memory.h"
+
+#if defined(TARGET_LINUX)
+#    include <sys/mman.h>
+#    include <unistd.h>
+#endif
+
+namespace ncore
+{
+    namespace ngfx
+    {
+        static constexpr u32 VMEM_COMMIT_SIZE = 64 * 1024;
+        static constexpr u32 VMEM_HUGE_SIZE   = 2 * 1024 * 1024;
+
+        vmem_alloc_t::vmem_alloc_t(u64 reserveSize, u32 flags)
+            : m_base(nullptr)
+            , m_mapping(nullptr)
+            , m_mappingSize(0)
+            , m_reserved(reserveSize)
+            , m_committed(0)
+            , m_top(0)
+            , m_last(0)
+            , m_lastTop(0)
+            , m_pageSize(4096)
+            , m_commitSize(VMEM_COMMIT_SIZE)
+            , m_flags(flags)
+        {
+        }
+
+        vmem_alloc_t::~vmem_alloc_t() { teardown(); }
+
+        bool vmem_alloc_t::setup()
+        {
+#if defined(TARGET_LINUX)
+            m_pageSize   = (u32)sysconf(_SC_PAGESIZE);
+            m_commitSize = (m_flags & HUGE_PAGES) ? VMEM_HUGE_SIZE : (m_pageSize > VMEM_COMMIT_SIZE ? m_pageSize : VMEM_COMMIT_SIZE);
+            m_reserved   = (m_reserved + m_commitSize - 1) & ~(u64)(m_commitSize - 1);
+
+            // For huge pages reserve an extra 2 MiB so that the range can be aligned to a huge page
+            m_mappingSize = m_reserved + ((m_flags & HUGE_PAGES) ? VMEM_HUGE_SIZE : 0);
+            void* mapping = mmap(nullptr, m_mappingSize, PROT_NONE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+            if (mapping == MAP_FAILED)
+            {
+                m_mappingSize = 0;
+                return false;
+            }
+
+            // mmap only guarantees page alignment, which is all the commit steps need. Only with huge pages is the base
+            // aligned further, the extra 2 MiB that was reserved for that keeps the range within the mapping.
+            m_mapping = (byte*)mapping;
+            m_base    = m_mapping;
+            if (m_flags & HUGE_PAGES)
+            {
+                m_base = (byte*)(((uint_t)m_mapping + VMEM_HUGE_SIZE - 1) & ~(uint_t)(VMEM_HUGE_SIZE - 1));
+                madvise(m_base, m_reserved, MADV_HUGEPAGE);  // A hint, fails when THP is disabled
+            }
+
+            m_committed = 0;
+            m_top       = 0;
+            m_last      = 0;
+            m_lastTop   = 0;
+            return true;
+#else
+            return false;
+#endif
+        }
+
+        void vmem_alloc_t::teardown()
+        {
+#if defined(TARGET_LINUX)
+            if (m_mapping != nullptr)
+                munmap(m_mapping, m_mappingSize);
+#endif
+            m_base        = nullptr;
+            m_mapping     = nullptr;
+            m_mappingSize = 0;
+            m_committed   = 0;
+            m_top         = 0;
+            m_last        = 0;
+            m_lastTop     = 0;
+        }
+
+        void* vmem_alloc_t::v_allocate(u32 size, u32 alignment)
+        {
+            ASSERT(alignment != 0 && (alignment & (alignment - 1)) == 0);  // Alignment must be a power of 2
+            if (m_base == nullptr)
+                return nullptr;
+
+            const u64 offset = (m_top + alignment - 1) & ~(u64)(alignment - 1);
+            const u64 top    = offset + size;
+            if (top > m_reserved)
+                return nullptr;
+            if (top > m_committed && !commit(top))
+                return nullptr;
+
+            m_last    = offset;
+            m_lastTop = m_top;
+            m_top     = top;
+            return m_base + offset;
+        }
+
+        void vmem_alloc_t::v_deallocate(void* ptr)
+        {
+            if (ptr == nullptr)
+                return;
+            ASSERT((byte*)ptr >= m_base && (byte*)ptr < m_base + m_top);
+
+            // Only the most recent allocation can be given back, the committed pages stay committed
+            if ((u64)((byte*)ptr - m_base) == m_last && m_top > m_last)
+                m_top = m_lastTop;
+        }
+
+        bool vmem_alloc_t::commit(u64 top)
+        {
+#if defined(TARGET_LINUX)
+            const u64 committed = (top + m_commitSize - 1) & ~(u64)(m_commitSize - 1);
+            if (mprotect(m_base + m_committed, committed - m_committed, PROT_READ | PROT_WRITE) != 0)
+                return false;
+            m_committed = committed;
+            return true;
+#else
+            return false;
+#endif
+        }
+
+        u64 vmem_alloc_t::decommit(void* ptr, u64 size)
+        {
+            u64 begin = (u64)((byte*)ptr - m_base);
+            u64 end   = begin + size;
+            begin     = (begin + m_pageSize - 1) & ~(u64)(m_pageSize - 1);
+            end       = end & ~(u64)(m_pageSize - 1);
+            if (end > m_committed)
+                end = m_committed;
+            if (end <= begin)
+                return 0;
+
+#if defined(TARGET_LINUX)
+            if (madvise(m_base + begin, end - begin, MADV_DONTNEED) != 0)
+                return 0;
+            return end - begin;
+#else
+            return 0;
+#endif
+        }
+
+        namespace nobject
+        {
+            // True when a bit in [first, last) is set
+            static bool vmem_any_used(u32 const* bits, u32 first, u32 last)
+            {
+                while (first < last)
+                {
+                    const u32 w    = first >> 5;
+                    const u32 end  = ((w + 1) << 5) < last ? ((w + 1) << 5) : last;
+                    const u32 n    = end - first;
+                    const u32 mask = (n == 32) ? 0xFFFFFFFF : (((1u << n) - 1) << (first & 31));
+                    if (bits[w] & mask)
+                        return true;
+                    first = end;
+                }
+                return false;
+            }
+
+            vmem_trim_t::vmem_trim_t()
+                : m_vmem(nullptr)
+                , m_array(nullptr)
+                , m_used_bits(nullptr)
+                , m_free_since(nullptr)
+                , m_candidates(nullptr)
+                , m_num_candidates(0)
+                , m_num_pages(0)
+                , m_min_free_frames(0)
+                , m_frame(0)
+            {
+            }
+
+            void vmem_trim_t::setup(alloc_t* allocator, vmem_alloc_t* vmem, array_t* array, u32 const* used_bits, u32 min_free_frames)
+            {
+                ASSERT(!array->is_chunked());
+
+                m_vmem            = vmem;
+                m_array           = array;
+                m_used_bits       = used_bits;
+                m_min_free_frames = min_free_frames;
+                m_frame           = 0;
+
+                // Only the pages that lie completely within the array
+                const u32    page_size = vmem->pageSize();
+                const uint_t begin     = ((uint_t)array->m_memory + page_size - 1) & ~(uint_t)(page_size - 1);
+                const uint_t end       = ((uint_t)array->m_memory + (uint_t)array->m_num_max * array->m_sizeof) & ~(uint_t)(page_size - 1);
+                m_num_pages            = end > begin ? (u32)((end - begin) / page_size) : 0;
+
+                // All pages start out as candidates, the ones with used items are dropped by the first update
+                const u32 num_words = (m_num_pages + 31) / 32;
+                m_free_since        = (u32*)g_allocate_and_clear(allocator, (m_num_pages > 0 ? m_num_pages : 1) * sizeof(u32));
+                m_candidates        = (u32*)g_allocate_and_clear(allocator, (num_words > 0 ? num_words : 1) * sizeof(u32));
+                for (u32 w = 0; w < num_words; ++w)
+                    m_candidates[w] = ((w + 1) * 32 <= m_num_pages) ? 0xFFFFFFFF : ((1u << (m_num_pages & 31)) - 1);
+                m_num_candidates = m_num_pages;
+            }
+
+            void vmem_trim_t::teardown(alloc_t* allocator)
+            {
+                allocator->deallocate(m_free_since);
+                allocator->deallocate(m_candidates);
+                m_free_since     = nullptr;
+                m_candidates     = nullptr;
+                m_num_candidates = 0;
+                m_num_pages      = 0;
+            }
+
+            void vmem_trim_t::freed(u32 index)
+            {
+                ASSERT(index < m_array->m_num_max);
+
+                // The pages that the item overlaps
+                const u32    page_size = m_vmem->pageSize();
+                const uint_t begin     = ((uint_t)m_array->m_memory + page_size - 1) & ~(uint_t)(page_size - 1);
+                const uint_t item      = (uint_t)m_array->m_memory + (uint_t)index * m_array->m_sizeof;
+                if (item + m_array->m_sizeof <= begin)
+                    return;
+                u32       p    = item > begin ? (u32)((item - begin) / page_size) : 0;
+                const u32 last = (u32)((item + m_array->m_sizeof - 1 - begin) / page_size);
+                for (; p <= last && p < m_num_pages; ++p)
+                {
+                    m_free_since[p] = m_frame;
+                    if ((m_candidates[p >> 5] & (1u << (p & 31))) == 0)
+                    {
+                        m_candidates[p >> 5] |= (1u << (p & 31));
+                        m_num_candidates++;
+                    }
+                }
+            }
+
+            u32 vmem_trim_t::update(u32 frame)
+            {
+                m_frame = frame;
+                if (m_num_candidates == 0)
+                    return 0;
+
+                const u32    page_size = m_vmem->pageSize();
+                const uint_t memory    = (uint_t)m_array->m_memory;
+                const uint_t begin     = (memory + page_size - 1) & ~(uint_t)(page_size - 1);
+
+                u32       count     = 0;
+                const u32 num_words = (m_num_pages + 31) / 32;
+                for (u32 w = 0; w < num_words; ++w)
+                {
+                    u32 bits = m_candidates[w];
+                    while (bits != 0)
+                    {
+                        const u32 bit = bits & (0 - bits);
+                        const u32 p   = (w << 5) + tzcnt_nonzero(bits);
+                        bits ^= bit;
+
+                        // The items that overlap the page
+                        const uint_t page  = begin + (uint_t)p * page_size;
+                        const u32    first = (u32)((page - memory) / m_array->m_sizeof);
+                        u32          last  = (u32)((page + page_size - memory + m_array->m_sizeof - 1) / m_array->m_sizeof);
+                        if (last > m_array->m_num_max)
+                            last = m_array->m_num_max;
+
+                        if (vmem_any_used(m_used_bits, first, last))
+                        {
+                            m_candidates[w] &= ~bit;
+                            m_num_candidates--;
+                        }
+                        else if ((frame - m_free_since[p]) >= m_min_free_frames)
+                        {
+                            m_vmem->decommit((void*)page, page_size);
+                            m_candidates[w] &= ~bit;
+                            m_num_candidates--;
+                            count++;
+                        }
+                    }
+                }
+                return count;
+            }
+        }  // namespace nobject
+    }  // namespace ngfx
+}  // namespace ncore
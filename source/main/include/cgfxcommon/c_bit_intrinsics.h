@@ -0,0 +1,61 @@
+#ifndef __C_GFX_COMMON_BIT_INTRINSICS_H__
+#define __C_GFX_COMMON_BIT_INTRINSICS_H__
+#include "ccore/c_target.h"
+#ifdef USE_PRAGMA_ONCE
+#    pragma once
+#endif
+
+// Internal bit scans of the offset allocators and the object pools. Not part of the public interface, only included from
+// .cpp files.
+
+namespace ncore
+{
+    namespace ngfx
+    {
+        inline u32 lzcnt_nonzero(u32 v)
+        {
+#ifdef _MSC_VER
+            unsigned long retVal;
+            _BitScanReverse(&retVal, v);
+            return 31 - retVal;
+#else
+            return __builtin_clz(v);
+#endif
+        }
+
+        inline u32 lzcnt_nonzero(u64 v)
+        {
+#ifdef _MSC_VER
+            unsigned long retVal;
+            _BitScanReverse64(&retVal, v);
+            return 63 - retVal;
+#else
+            return __builtin_clzll(v);
+#endif
+        }
+
+        inline u32 tzcnt_nonzero(u32 v)
+        {
+#ifdef _MSC_VER
+            unsigned long retVal;
+            _BitScanForward(&retVal, v);
+            return retVal;
+#else
+            return __builtin_ctz(v);
+#endif
+        }
+
+        inline u32 tzcnt_nonzero(u64 v)
+        {
+#ifdef _MSC_VER
+            unsigned long retVal;
+            _BitScanForward64(&retVal, v);
+            return retVal;
+#else
+            return __builtin_ctzll(v);
+#endif
+        }
+    }  // namespace ngfx
+}  // namespace ncore
+
+#endif  // __C_GFX_COMMON_BIT_INTRINSICS_H__
@@ -11,92 +11,301 @@ namespace ncore
 
     namespace ngfx
     {
-        static constexpr u32 NUM_TOP_BINS         = 32;
-        static constexpr u32 BINS_PER_LEAF        = 8;
-        static constexpr u32 TOP_BINS_INDEX_SHIFT = 3;
-        static constexpr u32 LEAF_BINS_INDEX_MASK = 0x7;
-        static constexpr u32 NUM_LEAF_BINS        = NUM_TOP_BINS * BINS_PER_LEAF;
-
-        struct allocation_t
+        // The offset allocator is implemented for 32-bit (u32) and 64-bit (u64) offsets and sizes.
+        // The 32-bit version manages ranges smaller than 2 GiB, the 64-bit version is for larger heaps.
+        namespace noffset
         {
-            static constexpr u32 NO_SPACE = 0xffffffff;
+            // Leaf bin bitmask, one bit per mantissa value, only 2 to 5 mantissa bits are supported
+            template <u32 MANTISSA_BITS>
+            struct leaf_mask_t;
+            template <>
+            struct leaf_mask_t<2>
+            {
+                typedef u8 type;
+            };
+            template <>
+            struct leaf_mask_t<3>
+            {
+                typedef u8 type;
+            };
+            template <>
+            struct leaf_mask_t<4>
+            {
+                typedef u16 type;
+            };
+            template <>
+            struct leaf_mask_t<5>
+            {
+                typedef u32 type;
+            };
 
-            u32 offset   = NO_SPACE;
-            u32 metadata = NO_SPACE;  // internal: node index
-        };
+            // Bin layout, sizes are binned as small floats (exponent + MANTISSA_BITS mantissa), one top bin per exponent
+            // and one leaf bin per mantissa value. More mantissa bits means less internal waste (worst case about
+            // 1 / 2^MANTISSA_BITS) but more bins to scan. The top bin bitmask has the same width as the offset type.
+            template <typename T, u32 MANTISSA_BITS = 3>
+            struct bins_t
+            {
+                typedef typename leaf_mask_t<MANTISSA_BITS>::type mask_t;
 
-        struct storage_report_t
-        {
-            u32 totalFreeSpace;
-            u32 largestFreeRegion;
-        };
+                static constexpr u32 NUM_TOP_BINS         = sizeof(T) * 8;
+                static constexpr u32 BINS_PER_LEAF        = 1 << MANTISSA_BITS;
+                static constexpr u32 TOP_BINS_INDEX_SHIFT = MANTISSA_BITS;
+                static constexpr u32 LEAF_BINS_INDEX_MASK = BINS_PER_LEAF - 1;
+                static constexpr u32 NUM_LEAF_BINS        = NUM_TOP_BINS * BINS_PER_LEAF;
 
-        struct full_storage_report_t
-        {
-            struct Region
+                // Smallest size of a bin, saturates at the maximum of T for bins beyond the range of T
+                static constexpr T binSize(u32 binIndex)
+                {
+                    const u32 exponent = binIndex >> TOP_BINS_INDEX_SHIFT;
+                    const u32 mantissa = binIndex & LEAF_BINS_INDEX_MASK;
+                    if (exponent == 0)
+                        return (T)mantissa;  // Denorms
+                    if ((exponent - 1 + MANTISSA_BITS) >= (sizeof(T) * 8))
+                        return (T)~(T)0;
+                    return (T)(mantissa | BINS_PER_LEAF) << (exponent - 1);
+                }
+            };
+
+            // Placement hint. Without a hint the smallest fitting free block is used. Hinted blocks are taken from the
+            // largest free block, long-lived ones from its start and transient ones from its end, which keeps the two
+            // apart so that freeing transient blocks gives back large contiguous free space.
+            enum hint_t
             {
-                u32 size;
-                u32 count;
+                HINT_NONE       = 0,
+                HINT_LONG_LIVED = 1,
+                HINT_TRANSIENT  = 2,
             };
 
-            Region freeRegions[NUM_LEAF_BINS];
-        };
+            template <typename T>
+            struct allocation_t
+            {
+                static constexpr T NO_SPACE = (T)~(T)0;
 
-        class offset_allocator_t
-        {
-        public:
-            offset_allocator_t(alloc_t* allocator, u32 size, u32 maxAllocs = 128 * 1024);
-            offset_allocator_t(offset_allocator_t&& other);
-            ~offset_allocator_t();
-
-            void setup();
-            void teardown();
-            void reset();
-
-            allocation_t          allocate(u32 size);
-            void                  free(allocation_t allocation);
-            u32                   allocationSize(allocation_t allocation) const;
-            storage_report_t      storageReport() const;
-            full_storage_report_t storageReportFull() const;
-
-        private:
-            u32  insertNodeIntoBin(u32 size, u32 dataOffset);
-            void removeNodeFromBin(u32 nodeIndex);
-
-            inline bool isUsed(u32 index) const { return (m_used[index >> 5] & (1 << (index & 31))) != 0; }
-            inline void setUsed(u32 index) { m_used[index >> 5] |= (1 << (index & 31)); }
-            inline void setUnused(u32 index) { m_used[index >> 5] &= ~(1 << (index & 31)); }
-
-            struct node_t
+                T offset   = NO_SPACE;
+                T metadata = NO_SPACE;  // internal: node index
+            };
+
+            template <typename T>
+            struct storage_report_t
+            {
+                T totalFreeSpace;
+                T largestFreeRegion;
+                T inFlightSpace;  // size of the deferred frees that are not yet retired
+            };
+
+            template <typename T, u32 MANTISSA_BITS = 3>
+            struct full_storage_report_t
             {
-                static constexpr u32 NIL = 0xffffffff;
+                struct Region
+                {
+                    T   size;       // smallest size of the bin
+                    u32 count;      // number of free blocks in the bin
+                    T   totalSize;  // total size of the free blocks in the bin
+                };
 
-                u32 dataOffset  = 0;
-                u32 dataSize    = 0;
-                u32 binListPrev = NIL;
-                u32 binListNext = NIL;
+                Region freeRegions[bins_t<T, MANTISSA_BITS>::NUM_LEAF_BINS];
+            };
+
+            // Cheap snapshot of the free space, the numbers are maintained incrementally so this can be taken every frame.
+            // fragmentation is 1 - largestFreeBlock / totalFreeSpace (0 when all free space is a single block).
+            template <typename T>
+            struct fragmentation_report_t
+            {
+                u32 freeBlockCount;
+                u32 usedBlockCount;
+                T   totalFreeSpace;
+                T   largestFreeBlock;  // estimate, the average block size of the highest non-empty bin
+                f32 fragmentation;
+            };
+
+            // A run of the heap walk, a used or a free block, in offset order
+            template <typename T>
+            struct heap_run_t
+            {
+                T    offset;
+                T    size;
+                bool used;
+                u32  node;  // internal: node index
             };
 
-            struct neighbor_t
+            // A relocation planned by allocator_t::defragment, metadata identifies the allocation (it stays valid).
+            // NOTE: dstOffset < srcOffset, when the ranges overlap copy front to back in steps of at most (srcOffset - dstOffset) bytes.
+            template <typename T>
+            struct defrag_move_t
             {
-                u32 prev;
-                u32 next;  // 31 bits for index, 1 bit for used flag
+                T srcOffset;
+                T dstOffset;
+                T size;
+                T metadata;
             };
 
-            alloc_t*    m_allocator;
-            u32         m_size;
-            u32         m_maxAllocs;
-            u32         m_freeStorage;
-            u32         m_usedBinsTop;
-            u8          m_usedBins[NUM_TOP_BINS];
-            u32         m_binIndices[NUM_LEAF_BINS];
-            node_t*     m_nodes;
-            neighbor_t* m_neighbors;
-            u32*        m_used;
-            u32         m_freeIndex;
-            u32         m_freeListHead;
-            u32         m_freeOffset;
-        };
+            // The allocator is instantiated for u32/u64 offsets with 2 to 5 mantissa bits (default 3).
+            template <typename T, u32 MANTISSA_BITS = 3>
+            class allocator_t
+            {
+            public:
+                typedef bins_t<T, MANTISSA_BITS> bins;
+                typedef typename bins::mask_t    mask_t;
+
+                static constexpr u32 NUM_TOP_BINS         = bins::NUM_TOP_BINS;
+                static constexpr u32 BINS_PER_LEAF        = bins::BINS_PER_LEAF;
+                static constexpr u32 TOP_BINS_INDEX_SHIFT = bins::TOP_BINS_INDEX_SHIFT;
+                static constexpr u32 LEAF_BINS_INDEX_MASK = bins::LEAF_BINS_INDEX_MASK;
+                static constexpr u32 NUM_LEAF_BINS        = bins::NUM_LEAF_BINS;
+
+                allocator_t(alloc_t* allocator, T size, u32 maxAllocs = 128 * 1024);
+                allocator_t(allocator_t&& other);
+                ~allocator_t();
+
+                void setup();
+                void teardown();
+                void reset();
+
+                // Growing keeps every live allocation valid. growSize appends 'additionalSize' bytes at the end of the
+                // range (merged with a free tail), growCapacity raises the maximum number of allocations to 'maxAllocs'.
+                // Both return false when the allocator is out of nodes respectively the capacity would not increase.
+                bool growSize(T additionalSize);
+                bool growCapacity(u32 maxAllocs);
+                u32  capacity() const { return m_maxAllocs; }  // Maximum number of allocations (node indices are below this)
+
+                allocation_t<T> allocate(T size);
+                allocation_t<T> allocate(T size, T alignment, hint_t hint = HINT_NONE);  // alignment must be a power of 2
+                void            free(allocation_t<T> allocation);
+
+                // Claims the exact range [offset, offset + size), which must lie within a single free block. Returns NO_SPACE
+                // otherwise. The search starts at the block touched by the previous claim, so replaying a layout in
+                // ascending offset order costs O(1) per claim. The search walks the neighbor chain from there, so a claim far
+                // from the previous one (e.g. out of order) is O(n) in the number of blocks in the worst case.
+                allocation_t<T> allocateAt(T offset, T size);
+
+                // In-place resize, the offset of the allocation does not change. tryGrow extends the allocation into the
+                // next block when that one is free and large enough, shrink gives the tail back to the free space.
+                // Both return false when the allocation could not be resized, in which case it is unchanged.
+                bool tryGrow(allocation_t<T> allocation, T newSize);
+                bool shrink(allocation_t<T> allocation, T newSize);
+
+                // Batch variants: allocateMany carves all allocations out of a single free node when possible and
+                // returns the number of successful allocations (failed ones are NO_SPACE). freeMany sorts the given
+                // allocations in place by offset so that runs of neighboring blocks are merged in one step.
+                u32  allocateMany(T const* sizes, u32 count, allocation_t<T>* outAllocations);
+                void freeMany(allocation_t<T>* allocations, u32 count);
+
+                // Deferred free, the allocation is released by the first retire(frame) call with a frame >= 'frame'.
+                // Frames must be passed in non-decreasing order. Allocations waiting in the queue are not moved by defragment.
+                // retire releases all expired allocations in one coalescing pass (freeMany) and returns their number.
+                void freeDeferred(allocation_t<T> allocation, u64 frame);
+                u32  retire(u64 frame);
+
+                T                                       allocationSize(allocation_t<T> allocation) const;
+                storage_report_t<T>                     storageReport() const;
+                full_storage_report_t<T, MANTISSA_BITS> storageReportFull() const;
+                fragmentation_report_t<T>               fragmentationReport() const;
+
+                // Incremental compaction, slides used blocks down into the lowest free space, moving at most 'maxBytes'.
+                // Blocks are only moved to offsets that are a multiple of 'alignment' (power of 2).
+                // Returns the number of moves written to 'outMoves', the caller must copy the data and update the offset of
+                // each moved allocation. A used block larger than 'maxBytes' stops the pass.
+                u32 defragment(defrag_move_t<T>* outMoves, u32 maxMoves, T maxBytes, T alignment = 1);
+
+                // Heap walk over the physical neighbor chain, yields every used and free block from offset 0 up to the end of
+                // the range. Both return false when there is no (next) run. The allocator must not change during a walk.
+                bool heapFirst(heap_run_t<T>& run) const;
+                bool heapNext(heap_run_t<T>& run) const;
+
+                // Built on the heap walk. freeRunHistogram counts the free runs per power of 2 size, bucket i holds the runs
+                // of [2^i, 2^(i+1)) bytes and the last bucket also the larger ones, it returns the number of free runs.
+                // occupancyMap splits the range into 'numCells' equal cells and writes the used part of each cell (0 - 255).
+                u32  freeRunHistogram(u32* outCounts, u32 numBuckets) const;
+                void occupancyMap(u8* outMap, u32 numCells) const;
+
+                // Binary snapshot of the complete state (nodes with their neighbor links and used flags, bin heads,
+                // bin statistics and bitmaps). The blob is versioned, position independent and consists of plain arrays,
+                // so it can be stored as-is and loaded with a few memcpy calls. The snapshot must be loaded into an allocator
+                // with the same offset type and mantissa bits and at least as many maxAllocs, after setup().
+                // Saving fails while deferred frees are pending; the buffer must be 8 byte aligned.
+                u64  snapshotSize() const;
+                bool saveSnapshot(void* buffer, u64 bufferSize) const;
+                bool loadSnapshot(void const* buffer, u64 bufferSize);
+
+            private:
+                u32             findFreeBin(T size) const;
+                u32             findLargestBin() const;
+                allocation_t<T> allocateFromBin(u32 binIndex, T size, T alignment, hint_t hint);
+                u32             insertNodeIntoBin(T size, T dataOffset);
+                void            removeNodeFromBin(u32 nodeIndex);
+                u32             popFreeNode();
+                void            pushFreeNode(u32 nodeIndex);
+                u32             findLiveNode() const;
+                u32             findTailNode() const;
+                void            growDeferred();
+
+                inline bool isDeferred(u32 index) const { return m_deferredNodes != nullptr && (m_deferredNodes[index >> 5] & (1u << (index & 31))) != 0; }
+
+                struct neighbor_t
+                {
+                    u32 prev;
+                    u32 next;
+                };
+
+                // One record per node, free/merge only touch the node and its two neighbors. A used node is not part of
+                // a bin list, so its binListPrev holds the USED marker instead of a separate used bitarray.
+                struct node_t
+                {
+                    static constexpr u32 NIL  = 0xffffffff;
+                    static constexpr u32 USED = 0xfffffffe;
+
+                    T          dataOffset  = 0;
+                    T          dataSize    = 0;
+                    u32        binListPrev = NIL;
+                    u32        binListNext = NIL;
+                    neighbor_t neighbor    = {NIL, NIL};
+                };
+
+                inline bool isUsed(u32 index) const { return m_nodes[index].binListPrev == node_t::USED; }
+                inline void setUsed(u32 index) { m_nodes[index].binListPrev = node_t::USED; }
+
+                alloc_t*    m_allocator;
+                T           m_size;
+                u32         m_maxAllocs;
+                T           m_freeStorage;
+                T           m_usedBinsTop;
+                mask_t      m_usedBins[NUM_TOP_BINS];
+                u32         m_binIndices[NUM_LEAF_BINS];
+                u32         m_binCounts[NUM_LEAF_BINS];  // number of free nodes per bin
+                T           m_binTotals[NUM_LEAF_BINS];  // total size of the free nodes per bin
+                node_t*     m_nodes;
+                u32         m_freeIndex;
+                u32         m_freeListHead;
+                u32         m_freeOffset;
+                u32         m_freeNodes;
+                u32         m_cursorNode;  // a live node near the previous allocateAt, or NIL
+
+                // Deferred free ring, ordered by frame, m_deferredNodes marks the nodes that are in the ring
+                allocation_t<T>* m_deferred;
+                u64*             m_deferredFrames;
+                u32*             m_deferredNodes;
+                u32              m_deferredHead;
+                u32              m_deferredCount;
+                u32              m_deferredCapacity;
+                T                m_deferredSize;
+            };
+        }  // namespace noffset
+
+        typedef noffset::allocation_t<u32>           allocation_t;
+        typedef noffset::storage_report_t<u32>       storage_report_t;
+        typedef noffset::full_storage_report_t<u32>  full_storage_report_t;
+        typedef noffset::defrag_move_t<u32>          defrag_move_t;
+        typedef noffset::fragmentation_report_t<u32> fragmentation_report_t;
+        typedef noffset::heap_run_t<u32>             heap_run_t;
+        typedef noffset::allocator_t<u32>            offset_allocator_t;
+
+        typedef noffset::allocation_t<u64>           allocation64_t;
+        typedef noffset::storage_report_t<u64>       storage_report64_t;
+        typedef noffset::full_storage_report_t<u64>  full_storage_report64_t;
+        typedef noffset::defrag_move_t<u64>          defrag_move64_t;
+        typedef noffset::fragmentation_report_t<u64> fragmentation_report64_t;
+        typedef noffset::heap_run_t<u64>             heap_run64_t;
+        typedef noffset::allocator_t<u64>            offset_allocator64_t;
     }  // namespace ngfx
 }  // namespace ncore
 
@@ -0,0 +1,85 @@
+#ifndef __C_GFX_COMMON_OFFSET_ALLOCATOR_BLOCKS_H__
+#define __C_GFX_COMMON_OFFSET_ALLOCATOR_BLOCKS_H__
+#include "ccore/c_target.h"
+#ifdef USE_PRAGMA_ONCE
+#    pragma once
+#endif
+
+#include "cgfxcommon/c_offset_allocator.h"
+
+namespace ncore
+{
+    class alloc_t;
+
+    namespace ngfx
+    {
+        // An allocation from offset_allocator_blocks_t, the offset is relative to the start of its block.
+        struct block_allocation_t
+        {
+            static constexpr u32 NO_SPACE = 0xffffffff;
+
+            u32 offset   = NO_SPACE;
+            u32 metadata = NO_SPACE;  // internal: node index in the block
+            u32 block    = NO_SPACE;  // block id
+        };
+
+        // A growing list of blocks, each managed by its own offset_allocator_t, e.g. the device memory blocks of one
+        // memory class. A new block is created when no block can serve a request, a block that has been empty for
+        // 'cooldown' frames is released by releaseEmpty. The block is chosen with a max-tree over the largest free bin
+        // of every block, an allocation does not probe the blocks one by one.
+        // NOTE: Block ids of released blocks are reused, the user must release its backing memory for each id returned
+        //       by releaseEmpty and create it for a block id it has not seen before (see blockSize).
+        class offset_allocator_blocks_t
+        {
+        public:
+            offset_allocator_blocks_t(alloc_t* allocator, u32 blockSize, u32 maxBlocks = 64, u32 maxAllocsPerBlock = 16 * 1024, u32 cooldown = 3);
+            ~offset_allocator_blocks_t();
+
+            void setup();
+            void teardown();
+
+            // Requests larger than the block size get a block of their own
+            block_allocation_t allocate(u32 size, u32 alignment = 1);  // alignment must be a power of 2
+            void               free(block_allocation_t allocation);
+            u32                allocationSize(block_allocation_t allocation) const;
+
+            // Releases the blocks that are empty since at least 'cooldown' frames, frames must be non-decreasing.
+            // Writes the ids of the released blocks to 'outBlocks' and returns their number.
+            u32 releaseEmpty(u64 frame, u32* outBlocks, u32 maxBlocks);
+
+            u32 numBlocks() const { return m_numBlocks; }
+            u32 blockSize(u32 block) const;  // 0 when the block does not exist
+
+        private:
+            static constexpr u32 NIL   = 0xffffffff;
+            static constexpr u64 NEVER = 0xffffffffffffffffull;
+
+            struct block_t
+            {
+                offset_allocator_t* m_allocator;   // nullptr when the block does not exist
+                u32                 m_size;        // Size of the block
+                u32                 m_numAllocs;   // Number of live allocations
+                u64                 m_emptyFrame;  // Frame in which the block became empty, NEVER when in use
+            };
+
+            u32  createBlock(u32 size);
+            void releaseBlock(u32 block);
+            void updateBlock(u32 block);
+            void setSummary(u32 block, u32 value);
+            u32  findBlock(u32 minBin) const;
+
+            alloc_t* m_allocator;
+            block_t* m_blocks;
+            u32*     m_tree;  // Max-tree, leaf i holds 1 + the largest free bin of block i (0 = no free space)
+            u32      m_treeLeaves;
+            u32      m_blockSize;
+            u32      m_maxBlocks;
+            u32      m_maxAllocsPerBlock;
+            u32      m_cooldown;
+            u32      m_numBlocks;
+            u64      m_frame;
+        };
+    }  // namespace ngfx
+}  // namespace ncore
+
+#endif  // __C_GFX_COMMON_OFFSET_ALLOCATOR_BLOCKS_H__
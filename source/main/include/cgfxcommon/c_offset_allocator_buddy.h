@@ -0,0 +1,66 @@
+#ifndef __C_GFX_COMMON_OFFSET_ALLOCATOR_BUDDY_H__
+#define __C_GFX_COMMON_OFFSET_ALLOCATOR_BUDDY_H__
+#include "ccore/c_target.h"
+#ifdef USE_PRAGMA_ONCE
+#    pragma once
+#endif
+
+#include "cgfxcommon/c_offset_allocator.h"
+
+namespace ncore
+{
+    class alloc_t;
+
+    namespace ngfx
+    {
+        // A power-of-two buddy allocator with the same surface as offset_allocator_t (allocate, free, allocationSize,
+        // storageReport, fragmentationReport), so that code templated on the allocator type can use either one.
+        // Level 0 is the whole range, every next level halves the block size down to 'minBlockSize'. One bit per block
+        // tells whether a block is free, a mask tells which levels have free blocks, so finding a level is a bit-scan and
+        // merging with the buddy is a bit test. Blocks are aligned to their size.
+        // NOTE: Allocations are rounded up to a power of 2 (at least minBlockSize), the metadata holds the level.
+        class offset_allocator_buddy_t
+        {
+        public:
+            offset_allocator_buddy_t(alloc_t* allocator, u32 size, u32 minBlockSize = 256);  // both must be a power of 2
+            ~offset_allocator_buddy_t();
+
+            void setup();
+            void teardown();
+            void reset();
+
+            allocation_t allocate(u32 size);
+            allocation_t allocate(u32 size, u32 alignment);  // alignment must be a power of 2
+            void         free(allocation_t allocation);
+
+            u32                    allocationSize(allocation_t allocation) const;
+            storage_report_t       storageReport() const;
+            fragmentation_report_t fragmentationReport() const;
+
+        private:
+            static constexpr u32 NIL = 0xffffffff;
+
+            inline u32  blockSize(u32 level) const { return m_size >> level; }
+            inline u32  nodeIndex(u32 level, u32 block) const { return (1u << level) + block; }  // 1-based heap index
+            inline bool isFree(u32 node) const { return (m_freeBits[node >> 5] & (1u << (node & 31))) != 0; }
+
+            void pushBlock(u32 level, u32 block);
+            void removeBlock(u32 level, u32 block);
+
+            alloc_t* m_allocator;
+            u32      m_size;
+            u32      m_minBlockSize;
+            u32      m_numLevels;
+            u32      m_usedLevels;  // Bit i is set when level i has a free block
+            u32      m_freeStorage;
+            u32      m_numUsed;
+            u32*     m_freeBits;  // One bit per block of every level, indexed as a 1-based heap
+            u32*     m_next;      // Free list links, indexed by the first unit (minBlockSize) of a block
+            u32*     m_prev;
+            u32      m_freeHeads[32];
+            u32      m_freeCounts[32];
+        };
+    }  // namespace ngfx
+}  // namespace ncore
+
+#endif  // __C_GFX_COMMON_OFFSET_ALLOCATOR_BUDDY_H__
@@ -0,0 +1,89 @@
+#ifndef __C_GFX_COMMON_OFFSET_ALLOCATOR_INTRINSICS_H__
+#define __C_GFX_COMMON_OFFSET_ALLOCATOR_INTRINSICS_H__
+#include "ccore/c_target.h"
+#ifdef USE_PRAGMA_ONCE
+#    pragma once
+#endif
+
+// Internal helpers of the offset allocator front-ends: atomics and a spin lock. Not part of the public interface, only
+// included from .cpp files.
+
+namespace ncore
+{
+    namespace ngfx
+    {
+        inline u64 atomic_add(volatile u64* ptr, u64 value)
+        {
+#ifdef _MSC_VER
+            return (u64)_InterlockedExchangeAdd64((volatile __int64*)ptr, (__int64)value);
+#else
+            return __atomic_fetch_add(ptr, value, __ATOMIC_RELAXED);
+#endif
+        }
+
+        inline u64 atomic_load(volatile u64* ptr)
+        {
+#ifdef _MSC_VER
+            return *ptr;
+#else
+            return __atomic_load_n(ptr, __ATOMIC_RELAXED);
+#endif
+        }
+
+        // Stores 'desired' when *ptr equals 'expected', otherwise loads the current value into 'expected'
+        inline bool atomic_compare_exchange(volatile u64* ptr, u64& expected, u64 desired)
+        {
+#ifdef _MSC_VER
+            const u64 previous = (u64)_InterlockedCompareExchange64((volatile __int64*)ptr, (__int64)desired, (__int64)expected);
+            if (previous == expected)
+                return true;
+            expected = previous;
+            return false;
+#else
+            return __atomic_compare_exchange_n(ptr, &expected, desired, false, __ATOMIC_RELAXED, __ATOMIC_RELAXED);
+#endif
+        }
+
+        inline s32 atomic_exchange(volatile s32* ptr, s32 value)
+        {
+#ifdef _MSC_VER
+            return _InterlockedExchange((volatile long*)ptr, value);
+#else
+            return __atomic_exchange_n(ptr, value, __ATOMIC_ACQUIRE);
+#endif
+        }
+
+        inline s32 atomic_load(volatile s32* ptr)
+        {
+#ifdef _MSC_VER
+            return *ptr;
+#else
+            return __atomic_load_n(ptr, __ATOMIC_RELAXED);
+#endif
+        }
+
+        inline void atomic_release(volatile s32* ptr)
+        {
+#ifdef _MSC_VER
+            _InterlockedExchange((volatile long*)ptr, 0);
+#else
+            __atomic_store_n(ptr, 0, __ATOMIC_RELEASE);
+#endif
+        }
+
+        inline void spin_lock(volatile s32* lock)
+        {
+            // Test and test-and-set, spin on a plain load to keep the cache line shared while waiting
+            while (atomic_exchange(lock, 1) != 0)
+            {
+                while (atomic_load(lock) != 0)
+                {
+                }
+            }
+        }
+
+        inline void spin_unlock(volatile s32* lock) { atomic_release(lock); }
+    }  // namespace ngfx
+}  // namespace ncore
+
+#endif  // __C_GFX_COMMON_OFFSET_ALLOCATOR_INTRINSICS_H__
@@ -0,0 +1,59 @@
+#ifndef __C_GFX_COMMON_OFFSET_ALLOCATOR_MT_H__
+#define __C_GFX_COMMON_OFFSET_ALLOCATOR_MT_H__
+#include "ccore/c_target.h"
+#ifdef USE_PRAGMA_ONCE
+#    pragma once
+#endif
+
+#include "cgfxcommon/c_offset_allocator.h"
+
+namespace ncore
+{
+    class alloc_t;
+
+    namespace ngfx
+    {
+        // A thread-safe front-end for offset_allocator_t.
+        // Every thread owns a cache_t that holds a small number of pre-carved ranges per size class, allocations
+        // and frees that can be served by the cache do not take the lock. Only cache refills, cache returns and
+        // allocations larger than CACHE_MAX_SIZE touch the shared offset_allocator_t.
+        // NOTE: Cached allocations are rounded up to their size class (at most 12.5% overhead).
+        class offset_allocator_mt_t
+        {
+        public:
+            static constexpr u32 CACHE_MAX_SIZE    = 16 * 1024;  // Allocations larger than this are not cached
+            static constexpr u32 CACHE_NUM_CLASSES = 97;         // Number of size classes up to and including CACHE_MAX_SIZE
+            static constexpr u32 CACHE_DEPTH       = 8;          // Maximum number of cached ranges per size class
+            static constexpr u32 CACHE_REFILL      = 4;          // Number of ranges taken from or returned to the shared allocator at once
+
+            struct cache_t
+            {
+                cache_t();
+
+                u8           m_count[CACHE_NUM_CLASSES];
+                allocation_t m_ranges[CACHE_NUM_CLASSES][CACHE_DEPTH];
+            };
+
+            offset_allocator_mt_t(alloc_t* allocator, u32 size, u32 maxAllocs = 128 * 1024);
+            ~offset_allocator_mt_t();
+
+            void setup();
+            void teardown();  // All caches must be flushed before teardown
+
+            allocation_t     allocate(cache_t* cache, u32 size);
+            void             free(cache_t* cache, allocation_t allocation);
+            void             flush(cache_t* cache);  // Returns all cached ranges to the shared allocator
+            u32              allocationSize(allocation_t allocation) const;
+            storage_report_t storageReport() const;  // Cached ranges are reported as used
+
+        private:
+            void lock() const;
+            void unlock() const;
+
+            offset_allocator_t   m_allocator;
+            mutable volatile s32 m_lock;
+        };
+    }  // namespace ngfx
+}  // namespace ncore
+
+#endif  // __C_GFX_COMMON_OFFSET_ALLOCATOR_MT_H__
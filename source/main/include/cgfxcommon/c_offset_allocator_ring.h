@@ -0,0 +1,87 @@
+#ifndef __C_GFX_COMMON_OFFSET_ALLOCATOR_RING_H__
+#define __C_GFX_COMMON_OFFSET_ALLOCATOR_RING_H__
+#include "ccore/c_target.h"
+#ifdef USE_PRAGMA_ONCE
+#    pragma once
+#endif
+
+#include "cgfxcommon/c_offset_allocator.h"
+
+namespace ncore
+{
+    class alloc_t;
+
+    namespace ngfx
+    {
+        // A per-frame ring allocator for transient data (upload staging, dynamic constants).
+        // The ring is a single range taken from the backing offset_allocator_t at setup, offsets are in the space of the
+        // backing allocator. Allocation is a compare-and-swap on the ring head and can be done from multiple threads
+        // without locking, an attempt that does not fit leaves the head untouched.
+        // Allocations are not freed one by one, all allocations of a frame are released together when the frame retires.
+        // An allocation that does not fit at the end of the ring is placed at the start of the ring, when the ring is
+        // full (or the allocation is larger than the ring) it falls back to the backing allocator. Such an allocation is
+        // also released when its frame retires.
+        // NOTE: The backing allocator is not thread-safe. The ring calls it under lockBacking(), while the ring is in use
+        //       every other user of the backing allocator must do the same.
+        // NOTE: endFrame and retire must not run concurrently with allocate.
+        class offset_allocator_ring_t
+        {
+        public:
+            static constexpr u32 RING = 0xfffffffe;  // Metadata of allocations served by the ring
+
+            offset_allocator_ring_t(alloc_t* allocator, offset_allocator_t* backing, u32 size, u32 maxFrames = 4, u32 maxOverflow = 256);
+            ~offset_allocator_ring_t();
+
+            void setup();
+            void teardown();  // Releases all frames, the ring range is given back to the backing allocator
+
+            allocation_t allocate(u32 size, u32 alignment = 1);  // alignment must be a power of 2
+
+            // Closes the frame that is being recorded, 'frame' is its number. Frames must be passed in increasing order.
+            // retire releases all allocations of the closed frames with a number <= 'frame' and returns their number of frames.
+            void endFrame(u64 frame);
+            u32  retire(u64 frame);
+
+            // The lock that guards the backing allocator, shared with the other users of the backing allocator
+            void lockBacking();
+            void unlockBacking();
+
+            u32 highWaterMark() const { return m_highWater; }  // Most bytes allocated in a single frame (ring and overflow), failed ring attempts do not count
+            u32 overflowCount() const { return m_overflowTotal; }  // Number of allocations that fell back to the backing allocator
+
+        private:
+            struct frame_t
+            {
+                u64 m_frame;     // Frame number
+                u64 m_end;       // Ring position at the end of the frame
+                u32 m_overflow;  // Number of overflow allocations made in this frame
+            };
+
+            allocation_t allocateOverflow(u32 size, u32 alignment);
+
+            alloc_t*            m_allocator;
+            offset_allocator_t* m_backing;
+            allocation_t        m_range;        // The ring, as allocated from the backing allocator
+            u32                 m_size;         // Size of the ring
+            volatile u64        m_head;         // Ring position of the next allocation (not wrapped)
+            volatile u64        m_ringBytes;    // Bytes of the ring allocations of the frame being recorded
+            u64                 m_tail;         // Ring position of the oldest unretired allocation
+            u64                 m_frameStart;   // Ring position at the start of the frame being recorded
+            frame_t*            m_frames;       // Closed frames waiting to be retired
+            u32                 m_maxFrames;
+            u32                 m_frameHead;
+            u32                 m_frameCount;
+            allocation_t*       m_overflow;     // Overflow allocations in order of allocation
+            u32                 m_maxOverflow;
+            u32                 m_overflowHead;
+            u32                 m_overflowCount;
+            u32                 m_overflowOpen;   // Overflow allocations of the frame being recorded
+            u32                 m_overflowBytes;  // Overflow bytes of the frame being recorded
+            u32                 m_overflowTotal;
+            u32                 m_highWater;
+            volatile s32        m_backingLock;
+        };
+    }  // namespace ngfx
+}  // namespace ncore
+
+#endif  // __C_GFX_COMMON_OFFSET_ALLOCATOR_RING_H__
@@ -0,0 +1,75 @@
+#ifndef __C_GFX_COMMON_OFFSET_ALLOCATOR_SLAB_H__
+#define __C_GFX_COMMON_OFFSET_ALLOCATOR_SLAB_H__
+#include "ccore/c_target.h"
+#ifdef USE_PRAGMA_ONCE
+#    pragma once
+#endif
+
+#include "cgfxcommon/c_offset_allocator.h"
+
+namespace ncore
+{
+    class alloc_t;
+
+    namespace ngfx
+    {
+        // A small-block front-end for offset_allocator_t.
+        // Requests up to MAX_SIZE bytes are served from pages of PAGE_SIZE bytes that are carved out of the parent
+        // allocator, one size class per page and one bit per block. A small allocation is a bit-scan and does not
+        // use a node of the parent allocator. A page that becomes empty is given back to the parent allocator.
+        // Larger requests are passed on to the parent allocator.
+        // NOTE: Small allocations are rounded up to a multiple of CLASS_SIZE, blocks are CLASS_SIZE aligned.
+        class offset_allocator_slab_t
+        {
+        public:
+            static constexpr u32 CLASS_SIZE     = 64;                                 // Size class i serves blocks of (i + 1) * CLASS_SIZE
+            static constexpr u32 NUM_CLASSES    = 8;                                  // Number of size classes
+            static constexpr u32 MAX_SIZE       = NUM_CLASSES * CLASS_SIZE;           // Allocations larger than this go to the parent
+            static constexpr u32 PAGE_SIZE      = 16 * 1024;                          // Size of a page taken from the parent
+            static constexpr u32 PAGE_ALIGNMENT = 256;                                // Alignment of a page in the parent
+            static constexpr u32 PAGE_WORDS     = (PAGE_SIZE / CLASS_SIZE + 31) / 32;  // Number of words in the block bitmap of a page
+
+            offset_allocator_slab_t(alloc_t* allocator, offset_allocator_t* parent, u32 maxPages = 1024);
+            ~offset_allocator_slab_t();
+
+            void setup();
+            void teardown();  // Gives all pages back to the parent allocator
+
+            allocation_t allocate(u32 size);
+            void         free(allocation_t allocation);
+            u32          allocationSize(allocation_t allocation) const;
+            u32          numPages() const { return m_numPages; }  // Pages currently taken from the parent
+
+        private:
+            static constexpr u32 NIL      = 0xffffffff;
+            static constexpr u32 SLAB_BIT = 0x80000000;  // Set in the metadata of allocations served by a page
+
+            struct page_t
+            {
+                allocation_t m_range;               // The page as allocated from the parent
+                u32          m_free[PAGE_WORDS];    // One bit per block, 1 = free
+                u16          m_numFree;             // Number of free blocks
+                u16          m_numBlocks;           // Number of blocks in this page
+                u32          m_class;               // Size class of this page
+                u32          m_prev;                // Links of the partial list of the size class (or the free page list)
+                u32          m_next;
+            };
+
+            u32  allocatePage(u32 sizeClass);
+            void releasePage(u32 pageIndex);
+            void linkPage(u32 pageIndex);
+            void unlinkPage(u32 pageIndex);
+
+            alloc_t*            m_allocator;
+            offset_allocator_t* m_parent;
+            page_t*             m_pages;
+            u32                 m_maxPages;
+            u32                 m_numPages;
+            u32                 m_pageIndex;     // High water mark of the page array
+            u32                 m_freePageHead;  // Freelist of page records
+            u32                 m_partial[NUM_CLASSES];
+        };
+    }  // namespace ngfx
+}  // namespace ncore
+
+#endif  // __C_GFX_COMMON_OFFSET_ALLOCATOR_SLAB_H__
@@ -0,0 +1,97 @@
+#ifndef __C_GFX_COMMON_OFFSET_ALLOCATOR_TRACE_H__
+#define __C_GFX_COMMON_OFFSET_ALLOCATOR_TRACE_H__
+#include "ccore/c_target.h"
+#ifdef USE_PRAGMA_ONCE
+#    pragma once
+#endif
+
+#include "cgfxcommon/c_offset_allocator.h"
+
+namespace ncore
+{
+    class alloc_t;
+
+    namespace ngfx
+    {
+        // One allocate or free of a trace, 20 bytes.
+        // Allocations are numbered in the order they are made, a free refers to the number of its allocation.
+        struct trace_event_t
+        {
+            static constexpr u32 FREE = 0x80000000;  // Set in 'id' for a free
+
+            u32 time;    // Nanoseconds since the previous event (saturated)
+            u32 id;      // Allocation number, FREE bit for a free
+            u32 size;    // Requested size (allocate), 0 (free)
+            u32 offset;     // Resulting offset, NO_SPACE when the allocation failed
+            u32 alignment;  // Requested alignment (aligned allocate), 0 for an unaligned allocate and a free
+        };
+
+        // Records the allocate and free calls made through it and forwards them to an offset_allocator_t.
+        // Tracing is opt-in, code that wants a trace allocates through the recorder instead of the allocator.
+        // The trace is a versioned binary blob (header + events) that can be saved and replayed offline.
+        class offset_allocator_trace_t
+        {
+        public:
+            offset_allocator_trace_t(alloc_t* allocator, offset_allocator_t* target, u32 maxEvents);
+            ~offset_allocator_trace_t();
+
+            void setup();
+            void teardown();
+
+            allocation_t allocate(u32 size);
+            allocation_t allocate(u32 size, u32 alignment);
+            void         free(allocation_t allocation);
+
+            u32                  numEvents() const { return m_numEvents; }
+            trace_event_t const* events() const { return m_events; }
+            bool                 full() const { return m_numEvents == m_maxEvents; }  // Events beyond maxEvents are not recorded
+
+            u64  traceSize() const;
+            bool saveTrace(void* buffer, u64 bufferSize) const;
+
+            // Validates a saved trace and returns its events, nullptr when the blob is not a trace.
+            // 'outNumIds' receives the number of allocations in the trace.
+            static trace_event_t const* readTrace(void const* buffer, u64 bufferSize, u32& outNumEvents, u32& outNumIds);
+
+        private:
+            void record(u32 id, u32 size, u32 offset, u32 alignment = 0);
+            void trackId(u32 nodeIndex, u32 id);
+
+            alloc_t*            m_allocator;
+            offset_allocator_t* m_target;
+            trace_event_t*      m_events;
+            u32*                m_ids;  // Allocation number per node index of the target, follows the capacity of the target
+            u32                 m_maxEvents;
+            u32                 m_numIdSlots;
+            u32                 m_numEvents;
+            u32                 m_numIds;
+            u64                 m_lastTime;
+        };
+
+        // Result of replaying a trace. Latencies are in nanoseconds, taken from a histogram with the bins of the
+        // offset allocator (at most 12.5% above the real value). Peak nodes is the largest number of free plus used
+        // blocks seen during the replay. Moved counts the allocations that got a different offset than in the trace,
+        // replaying into the allocator type and size that recorded the trace reproduces it (0 moved).
+        struct trace_replay_report_t
+        {
+            u32 numAllocs;
+            u32 numFrees;
+            u32 numFailed;  // Allocations that failed in the replay
+            u32 numMoved;   // Allocations placed at a different offset than recorded
+            u32 peakNodes;
+            u32 p50;
+            u32 p90;
+            u32 p99;
+            u32 max;
+        };
+
+        // Drives 'allocator' through a trace. Every 'sampleInterval' events the fragmentation of the allocator is written
+        // to 'outFragmentation' (at most 'maxSamples'), the number of samples is returned. 'scratch' is used for the
+        // allocations of the replay. Instantiated for offset_allocator_t and offset_allocator_buddy_t.
+        template <typename A>
+        u32 replayTrace(A* allocator, alloc_t* scratch, trace_event_t const* events, u32 numEvents, u32 numIds, trace_replay_report_t& outReport, f32* outFragmentation = nullptr, u32 maxSamples = 0,
+                        u32 sampleInterval = 1024);
+    }  // namespace ngfx
+}  // namespace ncore
+
+#endif  // __C_GFX_COMMON_OFFSET_ALLOCATOR_TRACE_H__
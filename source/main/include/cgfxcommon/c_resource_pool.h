@@ -23,18 +23,76 @@ namespace ncore
 
         namespace nobject
         {
+            // An array of fixed size items. By default the memory for all items is allocated in setup, a chunked array
+            // (setup_chunked) only allocates a table of pages up front and allocates a page (2^page_shift items) the first
+            // time one of its items is committed, item addresses never change. The pools commit an index when they hand it
+            // out, so the capacity of a chunked array is an upper bound and not an up-front cost.
             struct array_t
             {
                 array_t();
 
-                byte* m_memory;
-                u32   m_sizeof;
-                u32   m_num_max;
+                byte*    m_memory;
+                u32      m_sizeof;
+                u32      m_num_max;
+                byte**   m_pages;  // nullptr when the array is not chunked
+                u32      m_page_shift;
+                u32      m_page_mask;
+                alloc_t* m_allocator;  // Pages are allocated from this allocator
 
-                void        setup(alloc_t* allocator, u32 max_num_resources, u32 sizeof_resource);
-                void        teardown(alloc_t* allocator);
-                void*       get_access(u32 index) { return &m_memory[index * m_sizeof]; }
-                const void* get_access(u32 index) const { return &m_memory[index * m_sizeof]; }
+                void setup(alloc_t* allocator, u32 max_num_resources, u32 sizeof_resource);
+                void setup_chunked(alloc_t* allocator, u32 max_num_resources, u32 sizeof_resource, u32 page_shift = 10);
+                void teardown(alloc_t* allocator);
+
+                inline bool is_chunked() const { return m_pages != nullptr; }
+                inline u32  num_pages() const { return is_chunked() ? ((m_num_max + m_page_mask) >> m_page_shift) : 0; }
+
+                // Makes sure the memory of 'index' exists, a no-op for a non-chunked array
+                inline void commit(u32 index)
+                {
+                    if (m_pages != nullptr && m_pages[index >> m_page_shift] == nullptr)
+                        commit_page(index >> m_page_shift);
+                }
+
+                void*       get_access(u32 index) { return (m_pages == nullptr) ? &m_memory[index * m_sizeof] : &m_pages[index >> m_page_shift][(index & m_page_mask) * m_sizeof]; }
+                const void* get_access(u32 index) const { return (m_pages == nullptr) ? &m_memory[index * m_sizeof] : &m_pages[index >> m_page_shift][(index & m_page_mask) * m_sizeof]; }
+
+            private:
+                void commit_page(u32 page);
+            };
+
+            // Visits the set bits of a bit array (32-bit words, bit i in word i >> 5) in increasing order, bits at or beyond
+            // 'num_bits' are ignored. The words are scanned 64 bits at a time and decoded into a small buffer of indices
+            // with a bit-scan, runs of empty words are skipped 256 bits at a time (SSE2 compares where available), so the
+            // cost follows the number of set bits and not the size of the array.
+            struct used_iterator_t
+            {
+                used_iterator_t(u32 const* bits, u32 num_bits)
+                    : m_bits(bits)
+                    , m_num_bits(num_bits)
+                    , m_num_words((num_bits + 31) >> 5)
+                    , m_word_index(0)
+                    , m_count(0)
+                    , m_pos(0)
+                {
+                }
+
+                inline bool next(u32& out_index)
+                {
+                    if (m_pos == m_count && !refill())
+                        return false;
+                    out_index = m_indices[m_pos++];
+                    return true;
+                }
+
+                bool refill();  // Decodes the next non-empty 64 bits into m_indices, false at the end of the array
+
+                u32 const* m_bits;
+                u32        m_num_bits;
+                u32        m_num_words;
+                u32        m_word_index;
+                u32        m_count;
+                u32        m_pos;
+                u32        m_indices[64];
             };
 
             // An inventory is using array_t but it has an additional bit array to mark if an item is used or free.
@@ -43,11 +101,13 @@ namespace ncore
                 inventory_t();
 
                 void setup(alloc_t* allocator, u32 max_num_resources, u32 sizeof_resource);
+                void setup_chunked(alloc_t* allocator, u32 max_num_resources, u32 sizeof_resource, u32 page_shift = 10);
                 void teardown(alloc_t* allocator);
 
                 inline void allocate(u32 index)
                 {
                     ASSERT(is_free(index));
+                    m_array.commit(index);
                     set_used(index);
                 }
 
@@ -82,10 +142,62 @@ namespace ncore
                 inline void*       get_access(u32 index) { return m_array.get_access(index); }
                 inline const void* get_access(u32 index) const { return m_array.get_access(index); }
 
+                // Visit all used indices in increasing order
+                inline used_iterator_t iterate_used() const { return used_iterator_t(m_bitarray, m_array.m_num_max); }
+
+                template <typename F>
+                inline void for_each_used(F fn) const
+                {
+                    used_iterator_t iter = iterate_used();
+                    u32             index;
+                    while (iter.next(index))
+                        fn(index);
+                }
+
                 u32*    m_bitarray;
                 array_t m_array;
             };
 
+            // A hierarchical bit array with one bit per index (1 = used) in level 0. Every upper level has a bit per word
+            // of the level below, set when that word is full, so finding a free index reads one word per level. The bits
+            // beyond 'count' are marked used and are never handed out. Level 0 is a plain bit array, words() can be
+            // iterated with used_iterator_t.
+            struct used_map_t
+            {
+                used_map_t();
+
+                void setup(alloc_t* allocator, u32 count);
+                void teardown(alloc_t* allocator);
+                void clear();  // Marks all indices free
+
+                inline bool is_used(u32 index) const { return (m_levels[0][index >> 5] & (1u << (index & 31))) != 0; }
+                inline void set_used(u32 index) { set_bits(0, index >> 5, 1u << (index & 31)); }
+                inline void set_free(u32 index) { clear_bits(0, index >> 5, 1u << (index & 31)); }
+
+                // Marks the bits of 'mask' in level-0 word 'word' used or free, one update per word and level
+                inline void set_word_used(u32 word, u32 mask) { set_bits(0, word, mask); }
+                inline void set_word_free(u32 word, u32 mask) { clear_bits(0, word, mask); }
+
+                s32 find_free_word() const;  // Lowest level-0 word with a free bit, -1 when all indices are used
+                s32 find_and_set();          // Marks the lowest free index used and returns it, -1 when all indices are used
+
+                inline u32 const* words() const { return m_levels[0]; }
+                inline u32        word(u32 word) const { return m_levels[0][word]; }
+
+                enum
+                {
+                    MAX_LEVELS = 7  // 32^7 > 2^32
+                };
+
+                u32* m_levels[MAX_LEVELS];
+                u32  m_num_levels;
+                u32  m_count;
+
+            private:
+                void set_bits(u32 level, u32 word, u32 mask);
+                void clear_bits(u32 level, u32 word, u32 mask);
+            };
+
             struct pool_t
             {
                 pool_t();
@@ -97,6 +209,14 @@ namespace ncore
                 void deallocate(u32 index);
                 void free_all();
 
+                // Allocate 'count' indices in one go, returns the number of indices written to 'out_indices' (less than
+                // 'count' when the pool runs out). The free bits of the lowest non-full words are claimed a word at a time,
+                // the used map finds each word with one read per level, so a batch fills the lowest holes first and ends
+                // up in adjacent slots when the pool has no holes. deallocate_many updates the used map once per word of
+                // consecutive indices, passing the indices in increasing order is the fast path.
+                u32  allocate_many(u32 count, u32* out_indices);
+                void deallocate_many(u32 const* indices, u32 count);
+
                 template <typename T>
                 u32 construct()
                 {
@@ -117,10 +237,76 @@ namespace ncore
                 void*       get_access(u32 index);
                 const void* get_access(u32 index) const;
 
+                // Visit all used indices in increasing order
+                inline used_iterator_t iterate_used() const { return used_iterator_t(m_used_map.words(), m_object_array->m_num_max); }
+
+                // One bit per index, 1 = used (e.g. for vmem_trim_t)
+                inline u32 const* used_bits() const { return m_used_map.words(); }
+
+                template <typename F>
+                inline void for_each_used(F fn) const
+                {
+                    used_iterator_t iter = iterate_used();
+                    u32             index;
+                    while (iter.next(index))
+                        fn(index);
+                }
+
                 static const u32 c_invalid_handle = 0xFFFFFFFF;
 
+                array_t*   m_object_array;
+                used_map_t m_used_map;
+            };
+
+            // A pool that keeps the live objects packed at the front of the array, so iterating over the dense range
+            // [0, size()) streams linearly through memory. Handles (indices) stay stable, 'm_sparse' maps a handle to its
+            // dense slot and 'm_dense' maps a dense slot back to its handle. The dense array holds every handle, the first
+            // 'm_size' are live and the rest are free. Deallocate moves the last object into the hole (swap-remove).
+            // NOTE: Objects are moved with memcpy, they must not hold pointers to themselves.
+            struct dense_pool_t
+            {
+                dense_pool_t();
+
+                void setup(array_t* object_array, alloc_t* allocator);
+                void teardown(alloc_t* allocator);
+
+                u32  allocate();
+                void deallocate(u32 index);
+                void free_all();
+
+                template <typename T>
+                u32 construct()
+                {
+                    const u32 index = allocate();
+                    void*     ptr   = get_access(index);
+                    new (signature_t(), ptr) T();
+                    return index;
+                }
+
+                template <typename T>
+                void destruct(u32 index)
+                {
+                    void* ptr = get_access(index);
+                    ((T*)ptr)->~T();
+                    deallocate(index);
+                }
+
+                inline bool is_used(u32 index) const { return m_sparse[index] < m_size; }
+                inline u32  size() const { return m_size; }
+
+                // Access by handle
+                void*       get_access(u32 index);
+                const void* get_access(u32 index) const;
+
+                // Access by dense slot, 0 <= dense < size()
+                inline void*       get_dense(u32 dense) { return m_object_array->get_access(dense); }
+                inline const void* get_dense(u32 dense) const { return m_object_array->get_access(dense); }
+                inline u32         get_index(u32 dense) const { return m_dense[dense]; }
+
                 array_t* m_object_array;
-                binmap_t m_free_resource_map;
+                u32*     m_sparse;  // handle -> dense slot
+                u32*     m_dense;   // dense slot -> handle
+                u32      m_size;    // number of live objects
             };
 
             namespace ntyped
@@ -217,6 +403,46 @@ namespace ncore
         // Pool that holds multiple resource pools
         namespace nresources
         {
+            // A hierarchical bit array with one bit per index (1 = used) in level 0. Every upper level has a bit per word
+            // of the level below, set when that word is full, so finding a free index reads one word per level. The bits
+            // beyond 'count' are marked used and are never handed out. Level 0 is a plain bit array, words() can be
+            // iterated with used_iterator_t.
+            struct used_map_t
+            {
+                used_map_t();
+
+                void setup(alloc_t* allocator, u32 count);
+                void teardown(alloc_t* allocator);
+                void clear();  // Marks all indices free
+
+                inline bool is_used(u32 index) const { return (m_levels[0][index >> 5] & (1u << (index & 31))) != 0; }
+                inline void set_used(u32 index) { set_bits(0, index >> 5, 1u << (index & 31)); }
+                inline void set_free(u32 index) { clear_bits(0, index >> 5, 1u << (index & 31)); }
+
+                // Marks the bits of 'mask' in level-0 word 'word' used or free, one update per word and level
+                inline void set_word_used(u32 word, u32 mask) { set_bits(0, word, mask); }
+                inline void set_word_free(u32 word, u32 mask) { clear_bits(0, word, mask); }
+
+                s32 find_free_word() const;  // Lowest level-0 word with a free bit, -1 when all indices are used
+                s32 find_and_set();          // Marks the lowest free index used and returns it, -1 when all indices are used
+
+                inline u32 const* words() const { return m_levels[0]; }
+                inline u32        word(u32 word) const { return m_levels[0][word]; }
+
+                enum
+                {
+                    MAX_LEVELS = 7  // 32^7 > 2^32
+                };
+
+                u32* m_levels[MAX_LEVELS];
+                u32  m_num_levels;
+                u32  m_count;
+
+            private:
+                void set_bits(u32 level, u32 word, u32 mask);
+                void clear_bits(u32 level, u32 word, u32 mask);
+            };
+
             struct pool_t
             {
                 void setup(alloc_t* allocator, u16 max_num_types);
@@ -314,6 +540,46 @@ namespace ncore
             // - max 1024 resource types (0 to 1023)
             // - max 64 tag types (0 to 63)
             // - 2 billion objects (2^31)
+            // A hierarchical bit array with one bit per index (1 = used) in level 0. Every upper level has a bit per word
+            // of the level below, set when that word is full, so finding a free index reads one word per level. The bits
+            // beyond 'count' are marked used and are never handed out. Level 0 is a plain bit array, words() can be
+            // iterated with used_iterator_t.
+            struct used_map_t
+            {
+                used_map_t();
+
+                void setup(alloc_t* allocator, u32 count);
+                void teardown(alloc_t* allocator);
+                void clear();  // Marks all indices free
+
+                inline bool is_used(u32 index) const { return (m_levels[0][index >> 5] & (1u << (index & 31))) != 0; }
+                inline void set_used(u32 index) { set_bits(0, index >> 5, 1u << (index & 31)); }
+                inline void set_free(u32 index) { clear_bits(0, index >> 5, 1u << (index & 31)); }
+
+                // Marks the bits of 'mask' in level-0 word 'word' used or free, one update per word and level
+                inline void set_word_used(u32 word, u32 mask) { set_bits(0, word, mask); }
+                inline void set_word_free(u32 word, u32 mask) { clear_bits(0, word, mask); }
+
+                s32 find_free_word() const;  // Lowest level-0 word with a free bit, -1 when all indices are used
+                s32 find_and_set();          // Marks the lowest free index used and returns it, -1 when all indices are used
+
+                inline u32 const* words() const { return m_levels[0]; }
+                inline u32        word(u32 word) const { return m_levels[0][word]; }
+
+                enum
+                {
+                    MAX_LEVELS = 7  // 32^7 > 2^32
+                };
+
+                u32* m_levels[MAX_LEVELS];
+                u32  m_num_levels;
+                u32  m_count;
+
+            private:
+                void set_bits(u32 level, u32 word, u32 mask);
+                void clear_bits(u32 level, u32 word, u32 mask);
+            };
+
             struct pool_t
             {
                 void setup(alloc_t* allocator, u32 max_num_object_types, u32 max_num_resource_types);
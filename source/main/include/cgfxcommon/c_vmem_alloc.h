@@ -0,0 +1,107 @@
+#ifndef __C_GFX_COMMON_VMEM_ALLOC_H__
+#define __C_GFX_COMMON_VMEM_ALLOC_H__
+#include "ccore/c_target.h"
+#ifdef USE_PRAGMA_ONCE
+#    pragma once
+#endif
+
+#include "ccore/c_allocator.h"
+
+namespace ncore
+{
+    namespace ngfx
+    {
+        namespace nobject
+        {
+            struct array_t;
+        }
+
+        // An allocator that reserves a range of address space up front (mmap PROT_NONE) and commits pages (mprotect)
+        // only when the allocations grow past the committed high-water mark. Meant as the backing of the large arrays
+        // of nobject::array_t and nobject::inventory_t, a pool can be set up for a large index space and only pays for
+        // what it touches. Allocation is linear, deallocate only gives back the most recent allocation, everything is
+        // released by teardown.
+        // With HUGE_PAGES the range is aligned to 2 MiB, marked for transparent huge pages and committed in 2 MiB steps.
+        // NOTE: Linux only, on other platforms setup fails.
+        class vmem_alloc_t : public alloc_t
+        {
+        public:
+            enum
+            {
+                HUGE_PAGES = 1,
+            };
+
+            vmem_alloc_t(u64 reserveSize, u32 flags = 0);
+            ~vmem_alloc_t();
+
+            bool setup();
+            void teardown();
+
+            inline u64 reserved() const { return m_reserved; }
+            inline u64 committed() const { return m_committed; }
+            inline u64 used() const { return m_top; }
+            inline u32 pageSize() const { return m_pageSize; }
+
+            // Gives the physical memory of the whole pages within [ptr, ptr + size) back to the OS, returns the number of
+            // bytes released (0 on platforms where nothing is released). The memory stays accessible and reads as zero the
+            // next time it is touched.
+            u64 decommit(void* ptr, u64 size);
+
+        protected:
+            virtual void* v_allocate(u32 size, u32 alignment);
+            virtual void  v_deallocate(void* ptr);
+
+        private:
+            bool commit(u64 top);
+
+            byte* m_base;
+            byte* m_mapping;  // Start of the mapping, m_base is aligned up from here for huge pages
+            u64   m_mappingSize;
+            u64   m_reserved;
+            u64   m_committed;
+            u64   m_top;
+            u64   m_last;     // Offset of the most recent allocation
+            u64   m_lastTop;  // Top before the most recent allocation
+            u32   m_pageSize;
+            u32   m_commitSize;
+            u32   m_flags;
+        };
+
+        namespace nobject
+        {
+            // Decommits the pages of an array (backed by a vmem_alloc_t) that have held no used item for a number of
+            // frames. 'used_bits' is the used bit array of the pool or inventory that uses the array (one bit per index,
+            // like pool_t::used_bits() and inventory_t::m_bitarray). A decommitted page comes back as zero pages when an
+            // item on it is used again, nothing has to be done for that.
+            // Only candidate pages are looked at: all pages right after setup, and from then on the pages of the items
+            // passed to freed(). A candidate that still has a used item is dropped, update costs a scan of the candidate
+            // bitmap plus the candidates, not a walk over every page.
+            // NOTE: Only for arrays that are not chunked, the content of free items is lost.
+            struct vmem_trim_t
+            {
+                vmem_trim_t();
+
+                void setup(alloc_t* allocator, vmem_alloc_t* vmem, array_t* array, u32 const* used_bits, u32 min_free_frames = 60);
+                void teardown(alloc_t* allocator);
+
+                // Call when an item of the array has been freed, its pages become candidates for decommitting.
+                void freed(u32 index);
+
+                // Call once per frame, returns the number of pages decommitted.
+                u32 update(u32 frame);
+
+                vmem_alloc_t* m_vmem;
+                array_t*      m_array;
+                u32 const*    m_used_bits;
+                u32*          m_free_since;  // Per page, the frame from which the page is a candidate
+                u32*          m_candidates;  // Bit per page, set when the page may have no used item
+                u32           m_num_candidates;
+                u32           m_num_pages;
+                u32           m_min_free_frames;
+                u32           m_frame;  // Frame of the last update
+            };
+        }  // namespace nobject
+    }  // namespace ngfx
+}  // namespace ncore
+
+#endif  // __C_GFX_COMMON_VMEM_ALLOC_H__
@@ -223,6 +223,586 @@ UNITTEST_SUITE_BEGIN(test_resource_pool)
             allocator->free(validateAll);
         }
 
+        UNITTEST_TEST(allocate_aligned)
+        {
+            ncore::ngfx::allocation_t a = allocator->allocate(1);
+            CHECK_EQUAL(0, a.offset);
+
+            // Aligned allocation, the leading padding [1, 256) is returned to the bins
+            ncore::ngfx::allocation_t b = allocator->allocate(1000, 256);
+            CHECK_EQUAL(256, b.offset);
+            CHECK_EQUAL(1000, allocator->allocationSize(b));
+
+            ncore::ngfx::storage_report_t report = allocator->storageReport();
+            CHECK_EQUAL(1024 * 1024 * 256 - 1 - 1000, report.totalFreeSpace);
+
+            // The padding node is reused by a small allocation
+            ncore::ngfx::allocation_t c = allocator->allocate(100);
+            CHECK_EQUAL(1, c.offset);
+
+            // The rest of the padding [101, 256) holds an 8 byte aligned allocation
+            ncore::ngfx::allocation_t d = allocator->allocate(24, 8);
+            CHECK_EQUAL(104, d.offset);
+
+            ncore::ngfx::allocation_t e = allocator->allocate(64, 4096);
+            CHECK_EQUAL(4096, e.offset);
+
+            allocator->free(b);
+            allocator->free(a);
+            allocator->free(e);
+            allocator->free(c);
+            allocator->free(d);
+
+            // End: Validate that allocator has no fragmentation left. Should be 100% clean.
+            ncore::ngfx::allocation_t validateAll = allocator->allocate(1024 * 1024 * 256);
+            CHECK_EQUAL(0, validateAll.offset);
+            allocator->free(validateAll);
+        }
+
+        UNITTEST_TEST(allocate_free_many)
+        {
+            u32 const                 sizes[] = {100, 200, 300, 400, 500};
+            ncore::ngfx::allocation_t allocations[5];
+            CHECK_EQUAL(5, allocator->allocateMany(sizes, 5, allocations));
+
+            // The batch is carved out of one node, so the allocations are contiguous
+            u32 offset = 0;
+            for (u32 i = 0; i < 5; i++)
+            {
+                CHECK_EQUAL(offset, allocations[i].offset);
+                CHECK_EQUAL(sizes[i], allocator->allocationSize(allocations[i]));
+                offset += sizes[i];
+            }
+
+            ncore::ngfx::allocation_t a = allocator->allocate(1000);
+            CHECK_EQUAL(1500, a.offset);
+
+            ncore::ngfx::storage_report_t report = allocator->storageReport();
+            CHECK_EQUAL(1024 * 1024 * 256 - 1500 - 1000, report.totalFreeSpace);
+
+            // Free 1 and 2 first, then the rest out of order with 'a' in between
+            allocator->free(allocations[1]);
+            allocator->free(allocations[2]);
+
+            ncore::ngfx::allocation_t toFree[] = {allocations[4], a, allocations[0], allocations[3]};
+            allocator->freeMany(toFree, 4);
+
+            ncore::ngfx::storage_report_t report2 = allocator->storageReport();
+            CHECK_EQUAL(1024 * 1024 * 256, report2.totalFreeSpace);
+            CHECK_EQUAL(1024 * 1024 * 256, report2.largestFreeRegion);
+
+            // End: Validate that allocator has no fragmentation left. Should be 100% clean.
+            ncore::ngfx::allocation_t validateAll = allocator->allocate(1024 * 1024 * 256);
+            CHECK_EQUAL(0, validateAll.offset);
+            allocator->free(validateAll);
+        }
+
+        UNITTEST_TEST(defragment)
+        {
+            ncore::ngfx::allocation_t a = allocator->allocate(1000);
+            ncore::ngfx::allocation_t b = allocator->allocate(2000);
+            ncore::ngfx::allocation_t c = allocator->allocate(1000);
+            ncore::ngfx::allocation_t d = allocator->allocate(3000);
+            CHECK_EQUAL(4000, d.offset);
+
+            allocator->free(a);
+            allocator->free(c);
+
+            // Budget only allows moving 'b'
+            ncore::ngfx::defrag_move_t moves[8];
+            u32                        numMoves = allocator->defragment(moves, 8, 2500);
+            CHECK_EQUAL(1, numMoves);
+            CHECK_EQUAL(1000, moves[0].srcOffset);
+            CHECK_EQUAL(0, moves[0].dstOffset);
+            CHECK_EQUAL(2000, moves[0].size);
+            CHECK_EQUAL(b.metadata, moves[0].metadata);
+
+            // The hole left by 'a' has been merged with the hole left by 'c'
+            numMoves = allocator->defragment(moves, 8, 1024 * 1024);
+            CHECK_EQUAL(1, numMoves);
+            CHECK_EQUAL(4000, moves[0].srcOffset);
+            CHECK_EQUAL(2000, moves[0].dstOffset);
+            CHECK_EQUAL(d.metadata, moves[0].metadata);
+
+            // Fully compacted
+            numMoves = allocator->defragment(moves, 8, 1024 * 1024);
+            CHECK_EQUAL(0, numMoves);
+
+            ncore::ngfx::storage_report_t report = allocator->storageReport();
+            CHECK_EQUAL(1024 * 1024 * 256 - 5000, report.totalFreeSpace);
+
+            ncore::ngfx::allocation_t e = allocator->allocate(1024 * 1024 * 128);
+            CHECK_EQUAL(5000, e.offset);
+            allocator->free(e);
+
+            // Existing allocations remain valid
+            CHECK_EQUAL(2000, allocator->allocationSize(b));
+            CHECK_EQUAL(3000, allocator->allocationSize(d));
+            allocator->free(b);
+            allocator->free(d);
+
+            // End: Validate that allocator has no fragmentation left. Should be 100% clean.
+            ncore::ngfx::allocation_t validateAll = allocator->allocate(1024 * 1024 * 256);
+            CHECK_EQUAL(0, validateAll.offset);
+            allocator->free(validateAll);
+        }
+
+        UNITTEST_TEST(defragment_aligned)
+        {
+            ncore::ngfx::allocation_t a = allocator->allocate(300);
+            ncore::ngfx::allocation_t b = allocator->allocate(1000, 256);
+            CHECK_EQUAL(512, b.offset);
+
+            // Moving 'b' down into the padding [300, 512) would break its alignment
+            ncore::ngfx::defrag_move_t moves[8];
+            CHECK_EQUAL(0, allocator->defragment(moves, 8, 1024 * 1024, 256));
+            CHECK_EQUAL(1, allocator->defragment(moves, 8, 1024 * 1024, 1));
+            CHECK_EQUAL(300, moves[0].dstOffset);
+
+            allocator->free(a);
+            allocator->free(b);
+
+            // End: Validate that allocator has no fragmentation left. Should be 100% clean.
+            ncore::ngfx::allocation_t validateAll = allocator->allocate(1024 * 1024 * 256);
+            CHECK_EQUAL(0, validateAll.offset);
+            allocator->free(validateAll);
+        }
+
+        UNITTEST_TEST(grow_size)
+        {
+            ncore::ngfx::offset_allocator_t small(Allocator, 1024, 32);
+            small.setup();
+
+            // Used tail, the grown range becomes a new free node
+            ncore::ngfx::allocation_t a = small.allocate(1024);
+            CHECK_EQUAL(0, a.offset);
+            CHECK_TRUE(small.growSize(1024));
+            ncore::ngfx::allocation_t b = small.allocate(1000);
+            CHECK_EQUAL(1024, b.offset);
+
+            // Free tail [2024, 2048), the grown range is merged with it
+            CHECK_TRUE(small.growSize(2048));
+            ncore::ngfx::allocation_t c = small.allocate(2048);
+            CHECK_EQUAL(2024, c.offset);
+
+            small.free(a);
+            small.free(b);
+            small.free(c);
+
+            ncore::ngfx::allocation_t validateAll = small.allocate(4096);
+            CHECK_EQUAL(0, validateAll.offset);
+            small.free(validateAll);
+
+            small.teardown();
+        }
+
+        UNITTEST_TEST(grow_capacity)
+        {
+            ncore::ngfx::offset_allocator_t small(Allocator, 1024, 32);
+            small.setup();
+
+            // Run out of nodes, then grow the capacity and continue
+            ncore::ngfx::allocation_t allocations[64];
+            u32                       count = 0;
+            while (count < 64)
+            {
+                allocations[count] = small.allocate(1);
+                if (allocations[count].offset == ncore::ngfx::allocation_t::NO_SPACE)
+                    break;
+                count++;
+            }
+            CHECK_TRUE(count < 32);
+
+            CHECK_FALSE(small.growCapacity(32));
+            CHECK_TRUE(small.growCapacity(64));
+            while (count < 64)
+            {
+                allocations[count] = small.allocate(1);
+                if (allocations[count].offset == ncore::ngfx::allocation_t::NO_SPACE)
+                    break;
+                CHECK_EQUAL(count, allocations[count].offset);
+                count++;
+            }
+            CHECK_TRUE(count >= 32);
+
+            // Allocations made before growing are still valid
+            for (u32 i = 0; i < count; i++)
+            {
+                CHECK_EQUAL(1, small.allocationSize(allocations[i]));
+                small.free(allocations[i]);
+            }
+
+            ncore::ngfx::allocation_t validateAll = small.allocate(1024);
+            CHECK_EQUAL(0, validateAll.offset);
+            small.free(validateAll);
+
+            small.teardown();
+        }
+
+        UNITTEST_TEST(free_deferred)
+        {
+            ncore::ngfx::allocation_t a = allocator->allocate(1024);
+            ncore::ngfx::allocation_t b = allocator->allocate(1024);
+            ncore::ngfx::allocation_t c = allocator->allocate(1024);
+            CHECK_EQUAL(2048, c.offset);
+
+            allocator->free(a);
+            allocator->freeDeferred(b, 1);
+            allocator->freeDeferred(c, 2);
+            CHECK_EQUAL(2048, allocator->storageReport().inFlightSpace);
+
+            // Nothing expired yet, the space of 'b' and 'c' is not reused
+            CHECK_EQUAL(0, allocator->retire(0));
+            ncore::ngfx::allocation_t d = allocator->allocate(2048);
+            CHECK_EQUAL(3072, d.offset);
+
+            // A block waiting for retirement is not moved by defragment
+            ncore::ngfx::defrag_move_t moves[8];
+            CHECK_EQUAL(0, allocator->defragment(moves, 8, 1024 * 1024));
+
+            CHECK_EQUAL(1, allocator->retire(1));
+            CHECK_EQUAL(1024, allocator->storageReport().inFlightSpace);
+            CHECK_EQUAL(1, allocator->retire(5));
+            CHECK_EQUAL(0, allocator->storageReport().inFlightSpace);
+
+            // 'a', 'b' and 'c' are merged into one free block again
+            ncore::ngfx::allocation_t e = allocator->allocate(3072);
+            CHECK_EQUAL(0, e.offset);
+
+            // Many frames, the ring grows and wraps around
+            ncore::ngfx::allocation_t allocations[1000];
+            for (u32 i = 0; i < 1000; i++)
+            {
+                allocations[i] = allocator->allocate(64);
+                allocator->freeDeferred(allocations[i], i / 10);
+                if ((i % 100) == 99)
+                    allocator->retire((i / 10) - 3);
+            }
+            CHECK_EQUAL(30 * 64, allocator->storageReport().inFlightSpace);
+            allocator->retire(100);
+            CHECK_EQUAL(0, allocator->storageReport().inFlightSpace);
+
+            allocator->free(d);
+            allocator->free(e);
+
+            // End: Validate that allocator has no fragmentation left. Should be 100% clean.
+            ncore::ngfx::allocation_t validateAll = allocator->allocate(1024 * 1024 * 256);
+            CHECK_EQUAL(0, validateAll.offset);
+            allocator->free(validateAll);
+        }
+
+        UNITTEST_TEST(fragmentation_report)
+        {
+            const u32 SIZE = 1024 * 1024 * 256;
+
+            ncore::ngfx::fragmentation_report_t report = allocator->fragmentationReport();
+            CHECK_EQUAL(1, report.freeBlockCount);
+            CHECK_EQUAL(0, report.usedBlockCount);
+            CHECK_EQUAL(SIZE, report.totalFreeSpace);
+            CHECK_EQUAL(SIZE, report.largestFreeBlock);
+            CHECK_EQUAL(0.0f, report.fragmentation);
+
+            ncore::ngfx::allocation_t a = allocator->allocate(1024);
+            ncore::ngfx::allocation_t b = allocator->allocate(1024);
+            ncore::ngfx::allocation_t c = allocator->allocate(1024);
+            allocator->free(b);
+
+            report = allocator->fragmentationReport();
+            CHECK_EQUAL(2, report.freeBlockCount);
+            CHECK_EQUAL(2, report.usedBlockCount);
+            CHECK_EQUAL(SIZE - 2048, report.totalFreeSpace);
+            CHECK_EQUAL(SIZE - 3072, report.largestFreeBlock);
+            CHECK_TRUE(report.fragmentation > 0.0f && report.fragmentation < 0.001f);
+
+            // The full report is maintained incrementally as well, 1024 is bin 64
+            ncore::ngfx::full_storage_report_t full = allocator->storageReportFull();
+            CHECK_EQUAL(1024, full.freeRegions[64].size);
+            CHECK_EQUAL(1, full.freeRegions[64].count);
+            CHECK_EQUAL(1024, full.freeRegions[64].totalSize);
+
+            allocator->free(a);
+            allocator->free(c);
+
+            report = allocator->fragmentationReport();
+            CHECK_EQUAL(1, report.freeBlockCount);
+            CHECK_EQUAL(0, report.usedBlockCount);
+            CHECK_EQUAL(0, allocator->storageReportFull().freeRegions[64].count);
+        }
+
+        // Replay 64 frames, each frame allocates 8 transient blocks (released 3 frames later) and 1 long-lived block.
+        // Returns the fragmentation after all transient blocks have been released.
+        static ncore::ngfx::fragmentation_report_t replayFrames(alloc_t* allocator, bool hinted)
+        {
+            ncore::ngfx::offset_allocator_t alloc(allocator, 16 * 1024 * 1024, 4096);
+            alloc.setup();
+
+            const u32                 NUM_FRAMES = 64;
+            const u32                 IN_FLIGHT  = 3;
+            const u32                 PER_FRAME  = 8;
+            ncore::ngfx::allocation_t transient[IN_FLIGHT][PER_FRAME];
+            ncore::ngfx::allocation_t longLived[NUM_FRAMES];
+
+            u32 rnd = 1;
+            for (u32 f = 0; f < NUM_FRAMES; f++)
+            {
+                const u32 slot = f % IN_FLIGHT;
+                if (f >= IN_FLIGHT)
+                {
+                    for (u32 i = 0; i < PER_FRAME; i++)
+                        alloc.free(transient[slot][i]);
+                }
+
+                for (u32 i = 0; i < PER_FRAME; i++)
+                {
+                    rnd                = rnd * 1664525 + 1013904223;
+                    const u32 size     = 1024 + ((rnd >> 8) % 8192);
+                    transient[slot][i] = hinted ? alloc.allocate(size, 1, ncore::ngfx::noffset::HINT_TRANSIENT) : alloc.allocate(size);
+                    if (i == (PER_FRAME / 2))
+                    {
+                        const u32 longSize = 4096 + ((rnd >> 4) % 16384);
+                        longLived[f]       = hinted ? alloc.allocate(longSize, 1, ncore::ngfx::noffset::HINT_LONG_LIVED) : alloc.allocate(longSize);
+                    }
+                }
+            }
+
+            for (u32 s = 0; s < IN_FLIGHT; s++)
+            {
+                for (u32 i = 0; i < PER_FRAME; i++)
+                    alloc.free(transient[s][i]);
+            }
+            ncore::ngfx::fragmentation_report_t report = alloc.fragmentationReport();
+
+            for (u32 f = 0; f < NUM_FRAMES; f++)
+                alloc.free(longLived[f]);
+            alloc.teardown();
+            return report;
+        }
+
+        UNITTEST_TEST(allocate_hinted)
+        {
+            // Without hints the long-lived blocks end up in between transient blocks
+            ncore::ngfx::fragmentation_report_t plain = replayFrames(Allocator, false);
+            CHECK_EQUAL(64, plain.usedBlockCount);
+            CHECK_TRUE(plain.freeBlockCount > 8);
+            CHECK_TRUE(plain.fragmentation > 0.0f);
+
+            // With hints all long-lived blocks are packed together, the free space is a single block
+            ncore::ngfx::fragmentation_report_t hinted = replayFrames(Allocator, true);
+            CHECK_EQUAL(64, hinted.usedBlockCount);
+            CHECK_EQUAL(1, hinted.freeBlockCount);
+            CHECK_EQUAL(0.0f, hinted.fragmentation);
+
+            // Transient blocks come from the end of the free space
+            ncore::ngfx::allocation_t a = allocator->allocate(1000, 1, ncore::ngfx::noffset::HINT_TRANSIENT);
+            CHECK_EQUAL(1024 * 1024 * 256 - 1000, a.offset);
+            ncore::ngfx::allocation_t b = allocator->allocate(1000, 256, ncore::ngfx::noffset::HINT_TRANSIENT);
+            CHECK_EQUAL(1024 * 1024 * 256 - 2048, b.offset);
+            ncore::ngfx::allocation_t c = allocator->allocate(1000, 1, ncore::ngfx::noffset::HINT_LONG_LIVED);
+            CHECK_EQUAL(0, c.offset);
+
+            allocator->free(a);
+            allocator->free(b);
+            allocator->free(c);
+
+            // End: Validate that allocator has no fragmentation left. Should be 100% clean.
+            ncore::ngfx::allocation_t validateAll = allocator->allocate(1024 * 1024 * 256);
+            CHECK_EQUAL(0, validateAll.offset);
+            allocator->free(validateAll);
+        }
+
+        UNITTEST_TEST(resize_in_place)
+        {
+            ncore::ngfx::allocation_t a = allocator->allocate(1000);
+            ncore::ngfx::allocation_t b = allocator->allocate(1000);
+            CHECK_EQUAL(1000, b.offset);
+
+            // The next block is used
+            CHECK_FALSE(allocator->tryGrow(a, 1500));
+            CHECK_EQUAL(1000, allocator->allocationSize(a));
+
+            // The next block is free, grow into it
+            allocator->free(b);
+            CHECK_TRUE(allocator->tryGrow(a, 1500));
+            CHECK_EQUAL(1500, allocator->allocationSize(a));
+            ncore::ngfx::allocation_t c = allocator->allocate(100);
+            CHECK_EQUAL(1500, c.offset);
+
+            // The next block is used, the tail becomes a free block of its own
+            CHECK_TRUE(allocator->shrink(a, 500));
+            CHECK_EQUAL(500, allocator->allocationSize(a));
+            CHECK_EQUAL(2, allocator->fragmentationReport().freeBlockCount);
+            ncore::ngfx::allocation_t d = allocator->allocate(512);
+            CHECK_EQUAL(500, d.offset);
+
+            // The next block is free, the tail is merged with it
+            CHECK_TRUE(allocator->shrink(c, 10));
+            CHECK_EQUAL(2, allocator->fragmentationReport().freeBlockCount);
+            CHECK_TRUE(allocator->tryGrow(c, 4000));
+
+            allocator->free(a);
+            allocator->free(c);
+            allocator->free(d);
+
+            // End: Validate that allocator has no fragmentation left. Should be 100% clean.
+            ncore::ngfx::allocation_t validateAll = allocator->allocate(1024 * 1024 * 256);
+            CHECK_EQUAL(0, validateAll.offset);
+            allocator->free(validateAll);
+        }
+
+        UNITTEST_TEST(allocate_at)
+        {
+            // Claim in the middle, the free space is split before and after it
+            ncore::ngfx::allocation_t a = allocator->allocateAt(4096, 1000);
+            CHECK_EQUAL(4096, a.offset);
+            CHECK_EQUAL(1000, allocator->allocationSize(a));
+            CHECK_EQUAL(2, allocator->fragmentationReport().freeBlockCount);
+
+            // Before the previous claim
+            ncore::ngfx::allocation_t b = allocator->allocateAt(0, 100);
+            CHECK_EQUAL(0, b.offset);
+
+            // Overlaps with a used block
+            ncore::ngfx::allocation_t c = allocator->allocateAt(4000, 200);
+            CHECK_EQUAL(ncore::ngfx::allocation_t::NO_SPACE, c.offset);
+            c = allocator->allocateAt(5000, 200);
+            CHECK_EQUAL(ncore::ngfx::allocation_t::NO_SPACE, c.offset);
+
+            // Directly after and at the very end
+            c = allocator->allocateAt(5096, 10);
+            CHECK_EQUAL(5096, c.offset);
+            ncore::ngfx::allocation_t d = allocator->allocateAt(1024 * 1024 * 256 - 64, 64);
+            CHECK_EQUAL(1024 * 1024 * 256 - 64, d.offset);
+
+            // Regular allocations still take the free space in between
+            ncore::ngfx::allocation_t e = allocator->allocate(1024);
+            CHECK_EQUAL(100, e.offset);
+
+            allocator->free(a);
+            allocator->free(b);
+            allocator->free(c);
+            allocator->free(d);
+            allocator->free(e);
+
+            // End: Validate that allocator has no fragmentation left. Should be 100% clean.
+            ncore::ngfx::allocation_t validateAll = allocator->allocate(1024 * 1024 * 256);
+            CHECK_EQUAL(0, validateAll.offset);
+            allocator->free(validateAll);
+        }
+
+        UNITTEST_TEST(snapshot)
+        {
+            ncore::ngfx::allocation_t allocations[64];
+            for (u32 i = 0; i < 64; i++)
+                allocations[i] = allocator->allocate(1000 + i * 16);
+            for (u32 i = 0; i < 64; i += 3)
+                allocator->free(allocations[i]);
+
+            const u64 size   = allocator->snapshotSize();
+            void*     buffer = Allocator->allocate((u32)size);
+            CHECK_FALSE(allocator->saveSnapshot(buffer, size - 8));
+            CHECK_TRUE(allocator->saveSnapshot(buffer, size));
+
+            // Restore into an allocator with more capacity
+            ncore::ngfx::offset_allocator_t* restored = Allocator->construct<ncore::ngfx::offset_allocator_t>(Allocator, 1024, 256 * 1024);
+            restored->setup();
+            CHECK_TRUE(restored->loadSnapshot(buffer, size));
+            Allocator->deallocate(buffer);
+
+            ncore::ngfx::fragmentation_report_t a = allocator->fragmentationReport();
+            ncore::ngfx::fragmentation_report_t b = restored->fragmentationReport();
+            CHECK_EQUAL(a.freeBlockCount, b.freeBlockCount);
+            CHECK_EQUAL(a.usedBlockCount, b.usedBlockCount);
+            CHECK_EQUAL(a.totalFreeSpace, b.totalFreeSpace);
+            CHECK_EQUAL(a.largestFreeBlock, b.largestFreeBlock);
+
+            // Both allocators make the same decisions from here on
+            for (u32 i = 0; i < 64; i++)
+            {
+                if (i % 3 != 0)
+                {
+                    CHECK_EQUAL(allocator->allocationSize(allocations[i]), restored->allocationSize(allocations[i]));
+                    continue;
+                }
+                ncore::ngfx::allocation_t x = allocator->allocate(900);
+                ncore::ngfx::allocation_t y = restored->allocate(900);
+                CHECK_EQUAL(x.offset, y.offset);
+                CHECK_EQUAL(x.metadata, y.metadata);
+                allocations[i] = x;
+            }
+            for (u32 i = 0; i < 64; i++)
+            {
+                allocator->free(allocations[i]);
+                restored->free(allocations[i]);
+            }
+
+            ncore::ngfx::allocation_t validateAll = restored->allocate(1024 * 1024 * 256);
+            CHECK_EQUAL(0, validateAll.offset);
+            restored->free(validateAll);
+
+            // A snapshot does not load into an allocator of a different type
+            ncore::ngfx::offset_allocator64_t* other = Allocator->construct<ncore::ngfx::offset_allocator64_t>(Allocator, 1024);
+            other->setup();
+            buffer = Allocator->allocate((u32)restored->snapshotSize());
+            CHECK_TRUE(restored->saveSnapshot(buffer, restored->snapshotSize()));
+            CHECK_FALSE(other->loadSnapshot(buffer, restored->snapshotSize()));
+            Allocator->deallocate(buffer);
+
+            other->teardown();
+            Allocator->destruct(other);
+            restored->teardown();
+            Allocator->destruct(restored);
+        }
+
+        UNITTEST_TEST(heap_walk)
+        {
+            // Used blocks of 1 KiB, free blocks between them: [U 1K][F 1K][U 1K][F 2K][U 1K][F rest]
+            ncore::ngfx::allocation_t allocations[7];
+            for (u32 i = 0; i < 7; i++)
+                allocations[i] = allocator->allocate(1024);
+            allocator->free(allocations[1]);
+            allocator->free(allocations[3]);
+            allocator->free(allocations[4]);
+            allocator->free(allocations[6]);
+
+            const u32 offsets[] = {0, 1024, 2048, 3072, 5120, 6144};
+            const u32 sizes[]   = {1024, 1024, 1024, 2048, 1024, 1024 * 1024 * 256 - 6144};
+            u32       numRuns   = 0;
+
+            ncore::ngfx::heap_run_t run;
+            for (bool valid = allocator->heapFirst(run); valid; valid = allocator->heapNext(run))
+            {
+                CHECK_EQUAL(offsets[numRuns], run.offset);
+                CHECK_EQUAL(sizes[numRuns], run.size);
+                CHECK_EQUAL((numRuns & 1) == 0, run.used);
+                numRuns++;
+            }
+            CHECK_EQUAL(6, numRuns);
+
+            // Free runs of 1K, 2K and the rest (bucket 27), the last bucket collects everything from 2^15 up
+            u32 histogram[16];
+            CHECK_EQUAL(3, allocator->freeRunHistogram(histogram, 16));
+            CHECK_EQUAL(1, histogram[10]);
+            CHECK_EQUAL(1, histogram[11]);
+            CHECK_EQUAL(1, histogram[15]);
+
+            // Cells of 2K over the first 8K, the rest of the range is free
+            u8 map[1024 * 128];
+            allocator->occupancyMap(map, 1024 * 128);
+            CHECK_EQUAL(127, map[0]);
+            CHECK_EQUAL(127, map[1]);
+            CHECK_EQUAL(127, map[2]);
+            CHECK_EQUAL(0, map[3]);
+
+            allocator->free(allocations[0]);
+            allocator->free(allocations[2]);
+            allocator->free(allocations[5]);
+            allocator->occupancyMap(map, 4);
+            CHECK_EQUAL(0, map[0]);
+            CHECK_TRUE(allocator->heapFirst(run));
+            CHECK_FALSE(run.used);
+            CHECK_FALSE(allocator->heapNext(run));
+        }
+
         UNITTEST_TEST(zero_fragmentation)
         {
             // Allocate 256x 1MB. Should fit. Then free four random slots and reallocate four slots.
@@ -279,5 +859,111 @@ UNITTEST_SUITE_BEGIN(test_resource_pool)
             allocator->free(validateAll);
         }
     }
+
+    UNITTEST_FIXTURE(offset_allocator_bins)
+    {
+        UNITTEST_ALLOCATOR;
+
+        UNITTEST_FIXTURE_SETUP() {}
+        UNITTEST_FIXTURE_TEARDOWN() {}
+
+        // Allocate 1 byte from a 1 MiB heap and return the largest free region (the remaining size rounded down to a bin)
+        template <u32 MANTISSA_BITS>
+        static u32 largestFreeRegionAfterOneByte(alloc_t* allocator)
+        {
+            ncore::ngfx::noffset::allocator_t<u32, MANTISSA_BITS> alloc(allocator, 1024 * 1024);
+            alloc.setup();
+
+            ncore::ngfx::allocation_t a = alloc.allocate(1);
+            u32 const                 largestFreeRegion = alloc.storageReport().largestFreeRegion;
+            alloc.free(a);
+
+            // End: Validate that allocator has no fragmentation left. Should be 100% clean.
+            ncore::ngfx::allocation_t validateAll = alloc.allocate(1024 * 1024);
+            CHECK_EQUAL(0, validateAll.offset);
+            alloc.free(validateAll);
+
+            alloc.teardown();
+            return largestFreeRegion;
+        }
+
+        UNITTEST_TEST(mantissa_bits)
+        {
+            // 1048575 bytes are free, more mantissa bits means less is lost to rounding down
+            CHECK_EQUAL(917504, largestFreeRegionAfterOneByte<2>(Allocator));
+            CHECK_EQUAL(983040, largestFreeRegionAfterOneByte<3>(Allocator));
+            CHECK_EQUAL(1015808, largestFreeRegionAfterOneByte<4>(Allocator));
+            CHECK_EQUAL(1032192, largestFreeRegionAfterOneByte<5>(Allocator));
+        }
+
+        UNITTEST_TEST(bin_sizes)
+        {
+            // Denorms are precise, normalized bins have the hidden high bit
+            CHECK_EQUAL(3, (ncore::ngfx::noffset::bins_t<u32, 2>::binSize(3)));
+            CHECK_EQUAL(4, (ncore::ngfx::noffset::bins_t<u32, 2>::binSize(4)));
+            CHECK_EQUAL((32 + 8) << 4, (ncore::ngfx::noffset::bins_t<u32, 5>::binSize(5 * 32 + 8)));
+            CHECK_EQUAL(0xffffffff, (ncore::ngfx::noffset::bins_t<u32, 5>::binSize(31 * 32)));
+        }
+    }
+
+    UNITTEST_FIXTURE(offset_allocator64)
+    {
+        UNITTEST_ALLOCATOR;
+
+        static const u64 c_heapSize = (u64)16 * 1024 * 1024 * 1024;  // 16 GiB
+
+        ncore::ngfx::offset_allocator64_t* allocator = nullptr;
+
+        UNITTEST_FIXTURE_SETUP()
+        {
+            allocator = Allocator->construct<ncore::ngfx::offset_allocator64_t>(Allocator, c_heapSize);
+            allocator->setup();
+        }
+
+        UNITTEST_FIXTURE_TEARDOWN()
+        {
+            allocator->teardown();
+            Allocator->destruct(allocator);
+        }
+
+        UNITTEST_TEST(allocate_large)
+        {
+            const u64 GiB = (u64)1024 * 1024 * 1024;
+
+            ncore::ngfx::allocation64_t a = allocator->allocate(8 * GiB);
+            CHECK_EQUAL(0, a.offset);
+
+            ncore::ngfx::allocation64_t b = allocator->allocate(1337);
+            CHECK_EQUAL(8 * GiB, b.offset);
+
+            ncore::ngfx::allocation64_t c = allocator->allocate(3 * GiB, 256);
+            CHECK_EQUAL(8 * GiB + 1536, c.offset);
+            CHECK_EQUAL(3 * GiB, allocator->allocationSize(c));
+
+            ncore::ngfx::storage_report64_t report = allocator->storageReport();
+            CHECK_EQUAL(c_heapSize - 11 * GiB - 1337, report.totalFreeSpace);
+
+            // Does not fit anymore
+            ncore::ngfx::allocation64_t d = allocator->allocate(6 * GiB);
+            CHECK_EQUAL(ncore::ngfx::allocation64_t::NO_SPACE, d.offset);
+
+            allocator->free(a);
+            d = allocator->allocate(6 * GiB);
+            CHECK_EQUAL(0, d.offset);
+
+            allocator->free(b);
+            allocator->free(c);
+            allocator->free(d);
+
+            ncore::ngfx::storage_report64_t report2 = allocator->storageReport();
+            CHECK_EQUAL(c_heapSize, report2.totalFreeSpace);
+            CHECK_EQUAL(c_heapSize, report2.largestFreeRegion);
+
+            // End: Validate that allocator has no fragmentation left. Should be 100% clean.
+            ncore::ngfx::allocation64_t validateAll = allocator->allocate(c_heapSize);
+            CHECK_EQUAL(0, validateAll.offset);
+            allocator->free(validateAll);
+        }
+    }
 }
 UNITTEST_SUITE_END
@@ -0,0 +1,120 @@
+#include "cgfxcommon/c_offset_allocator_blocks.h"
+#include "cgfxcommon/test_allocator.h"
+#include "cunittest/cunittest.h"
+
+using namespace ncore;
+
+UNITTEST_SUITE_BEGIN(test_offset_allocator_blocks)
+{
+    UNITTEST_FIXTURE(offset_allocator_blocks)
+    {
+        UNITTEST_ALLOCATOR;
+
+        ncore::ngfx::offset_allocator_blocks_t* blocks = nullptr;
+
+        UNITTEST_FIXTURE_SETUP()
+        {
+            // Blocks of 1 MiB, an empty block is released after 2 frames
+            blocks = Allocator->construct<ncore::ngfx::offset_allocator_blocks_t>(Allocator, 1024 * 1024, 8, 1024, 2);
+            blocks->setup();
+        }
+
+        UNITTEST_FIXTURE_TEARDOWN()
+        {
+            blocks->teardown();
+            Allocator->destruct(blocks);
+        }
+
+        UNITTEST_TEST(grow_and_release)
+        {
+            // Four allocations of 256 KiB fill a block, the fifth creates a second block
+            ncore::ngfx::block_allocation_t allocations[5];
+            for (u32 i = 0; i < 5; i++)
+                allocations[i] = blocks->allocate(256 * 1024);
+            CHECK_EQUAL(2, blocks->numBlocks());
+            for (u32 i = 0; i < 4; i++)
+            {
+                CHECK_EQUAL(0, allocations[i].block);
+                CHECK_EQUAL(i * 256 * 1024, allocations[i].offset);
+            }
+            CHECK_EQUAL(1, allocations[4].block);
+            CHECK_EQUAL(0, allocations[4].offset);
+            CHECK_EQUAL(1024 * 1024, blocks->blockSize(1));
+
+            // A free range in the first block is used before the second block
+            blocks->free(allocations[2]);
+            ncore::ngfx::block_allocation_t a = blocks->allocate(100 * 1024);
+            CHECK_EQUAL(0, a.block);
+            CHECK_EQUAL(2 * 256 * 1024, a.offset);
+
+            // A request larger than the block size gets a block of its own
+            ncore::ngfx::block_allocation_t b = blocks->allocate(3 * 1024 * 1024);
+            CHECK_EQUAL(2, b.block);
+            CHECK_EQUAL(3 * 1024 * 1024, blocks->blockSize(2));
+            CHECK_EQUAL(3 * 1024 * 1024, blocks->allocationSize(b));
+
+            // Empty blocks are only released after the cooldown
+            u32 released[8];
+            blocks->free(allocations[4]);
+            blocks->free(b);
+            CHECK_EQUAL(0, blocks->releaseEmpty(1, released, 8));
+            CHECK_EQUAL(3, blocks->numBlocks());
+            CHECK_EQUAL(2, blocks->releaseEmpty(2, released, 8));
+            CHECK_EQUAL(1, released[0]);
+            CHECK_EQUAL(2, released[1]);
+            CHECK_EQUAL(1, blocks->numBlocks());
+            CHECK_EQUAL(0, blocks->blockSize(1));
+
+            // A block that is used again before the cooldown is kept
+            blocks->free(a);
+            blocks->free(allocations[0]);
+            blocks->free(allocations[1]);
+            blocks->free(allocations[3]);
+            blocks->releaseEmpty(3, released, 8);
+            a = blocks->allocate(64);
+            CHECK_EQUAL(0, a.block);
+            CHECK_EQUAL(0, blocks->releaseEmpty(10, released, 8));
+            blocks->free(a);
+            CHECK_EQUAL(0, blocks->releaseEmpty(11, released, 8));
+            CHECK_EQUAL(1, blocks->releaseEmpty(12, released, 8));
+            CHECK_EQUAL(0, blocks->numBlocks());
+        }
+
+        UNITTEST_TEST(out_of_nodes)
+        {
+            // A block that runs out of nodes is skipped even though it has free space
+            ncore::ngfx::offset_allocator_blocks_t* small = Allocator->construct<ncore::ngfx::offset_allocator_blocks_t>(Allocator, 1024 * 1024, 4, 16, 1);
+            small->setup();
+
+            // 16 nodes per block serve 14 allocations
+            ncore::ngfx::block_allocation_t allocations[20];
+            for (u32 i = 0; i < 20; i++)
+                allocations[i] = small->allocate(64);
+            CHECK_EQUAL(0, allocations[13].block);
+            CHECK_EQUAL(1, allocations[14].block);
+            CHECK_EQUAL(2, small->numBlocks());
+
+            // Freeing two neighboring allocations merges them and gives back a node, the block is visible again
+            small->free(allocations[5]);
+            small->free(allocations[6]);
+            allocations[5] = small->allocate(64);
+            CHECK_EQUAL(0, allocations[5].block);
+            CHECK_EQUAL(5 * 64, allocations[5].offset);
+
+            for (u32 i = 0; i < 20; i++)
+            {
+                if (i == 6)
+                    continue;
+                small->free(allocations[i]);
+            }
+
+            u32 released[4];
+            CHECK_EQUAL(2, small->releaseEmpty(1, released, 4));
+            CHECK_EQUAL(0, small->numBlocks());
+
+            small->teardown();
+            Allocator->destruct(small);
+        }
+    }
+}
+UNITTEST_SUITE_END
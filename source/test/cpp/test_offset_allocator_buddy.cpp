@@ -0,0 +1,95 @@
+#include "cgfxcommon/c_offset_allocator_buddy.h"
+#include "cgfxcommon/test_allocator.h"
+#include "cunittest/cunittest.h"
+
+using namespace ncore;
+
+UNITTEST_SUITE_BEGIN(test_offset_allocator_buddy)
+{
+    UNITTEST_FIXTURE(offset_allocator_buddy)
+    {
+        UNITTEST_ALLOCATOR;
+
+        ncore::ngfx::offset_allocator_buddy_t* allocator = nullptr;
+
+        UNITTEST_FIXTURE_SETUP()
+        {
+            allocator = Allocator->construct<ncore::ngfx::offset_allocator_buddy_t>(Allocator, 1024 * 1024, 256);
+            allocator->setup();
+        }
+
+        UNITTEST_FIXTURE_TEARDOWN()
+        {
+            allocator->teardown();
+            Allocator->destruct(allocator);
+        }
+
+        UNITTEST_TEST(split_and_merge)
+        {
+            // Sizes are rounded up to a power of 2, at least the minimum block size
+            ncore::ngfx::allocation_t a = allocator->allocate(100);
+            CHECK_EQUAL(0, a.offset);
+            CHECK_EQUAL(256, allocator->allocationSize(a));
+
+            ncore::ngfx::allocation_t b = allocator->allocate(1000);
+            CHECK_EQUAL(1024, b.offset);
+            CHECK_EQUAL(1024, allocator->allocationSize(b));
+
+            // The buddy of 'a' is still free
+            ncore::ngfx::allocation_t c = allocator->allocate(256);
+            CHECK_EQUAL(256, c.offset);
+
+            ncore::ngfx::storage_report_t report = allocator->storageReport();
+            CHECK_EQUAL(1024 * 1024 - 256 - 256 - 1024, report.totalFreeSpace);
+            CHECK_EQUAL(512 * 1024, report.largestFreeRegion);
+
+            ncore::ngfx::fragmentation_report_t fragmentation = allocator->fragmentationReport();
+            CHECK_EQUAL(3, fragmentation.usedBlockCount);
+            CHECK_EQUAL(10, fragmentation.freeBlockCount);  // 512, 2048, 4096, ..., 512K
+
+            // Aligned allocations use a block of at least the alignment
+            ncore::ngfx::allocation_t d = allocator->allocate(64, 4096);
+            CHECK_EQUAL(4096, d.offset);
+            CHECK_EQUAL(4096, allocator->allocationSize(d));
+
+            allocator->free(a);
+            allocator->free(b);
+            allocator->free(c);
+            allocator->free(d);
+
+            // Everything merged back into a single block
+            fragmentation = allocator->fragmentationReport();
+            CHECK_EQUAL(1, fragmentation.freeBlockCount);
+            CHECK_EQUAL(0, fragmentation.usedBlockCount);
+
+            ncore::ngfx::allocation_t validateAll = allocator->allocate(1024 * 1024);
+            CHECK_EQUAL(0, validateAll.offset);
+            allocator->free(validateAll);
+        }
+
+        UNITTEST_TEST(out_of_space)
+        {
+            ncore::ngfx::allocation_t allocations[4];
+            for (u32 i = 0; i < 4; i++)
+            {
+                allocations[i] = allocator->allocate(200 * 1024);
+                CHECK_EQUAL(i * 256 * 1024, allocations[i].offset);
+            }
+            ncore::ngfx::allocation_t a = allocator->allocate(1);
+            CHECK_EQUAL(ncore::ngfx::allocation_t::NO_SPACE, a.offset);
+
+            allocator->free(allocations[1]);
+            a = allocator->allocate(1);
+            CHECK_EQUAL(256 * 1024, a.offset);
+            allocator->free(a);
+
+            for (u32 i = 0; i < 4; i++)
+            {
+                if (i != 1)
+                    allocator->free(allocations[i]);
+            }
+            CHECK_EQUAL(1024 * 1024, allocator->storageReport().largestFreeRegion);
+        }
+    }
+}
+UNITTEST_SUITE_END
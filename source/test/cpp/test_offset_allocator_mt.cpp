@@ -0,0 +1,229 @@
+#include "cgfxcommon/c_offset_allocator_mt.h"
+#include "cgfxcommon/test_allocator.h"
+#include "cunittest/cunittest.h"
+
+#include <thread>
+
+// The contention benchmark is not part of the unit tests, define OFFSET_ALLOCATOR_BENCHMARK to build it
+#ifdef OFFSET_ALLOCATOR_BENCHMARK
+#    include <chrono>
+#    include <stdio.h>
+#endif
+
+using namespace ncore;
+
+namespace
+{
+    // Test-only harness, runs a number of threads that each own a cache of the shared allocator
+    struct mt_worker_t
+    {
+        static constexpr u32 NUM_LIVE = 256;
+
+        ncore::ngfx::offset_allocator_mt_t*          allocator;
+        ncore::ngfx::offset_allocator_mt_t::cache_t* cache;
+        ncore::ngfx::allocation_t                    live[NUM_LIVE];
+        u32                                          seed;
+        u32                                          numOps;
+        u32                                          numFailed;
+
+        u32 random()
+        {
+            seed ^= seed << 13;
+            seed ^= seed >> 17;
+            seed ^= seed << 5;
+            return seed;
+        }
+
+        // Mixed small (cached) and large (locked) sizes, random frees and reallocations
+        void run()
+        {
+            for (u32 i = 0; i < NUM_LIVE; i++)
+                live[i] = ncore::ngfx::allocation_t();
+            for (u32 op = 0; op < numOps; op++)
+            {
+                const u32 slot = random() % NUM_LIVE;
+                if (live[slot].offset != ncore::ngfx::allocation_t::NO_SPACE)
+                    allocator->free(cache, live[slot]);
+                const u32 r    = random();
+                const u32 size = (r & 15) == 0 ? 16 * 1024 + (r >> 16) % (64 * 1024) : 1 + (r >> 16) % 4096;
+                live[slot]     = allocator->allocate(cache, size);
+                if (live[slot].offset == ncore::ngfx::allocation_t::NO_SPACE)
+                    numFailed++;
+            }
+        }
+    };
+
+    void mt_run_workers(mt_worker_t* workers, u32 numThreads)
+    {
+        std::thread threads[16];
+        for (u32 t = 0; t < numThreads; t++)
+            threads[t] = std::thread([workers, t]() { workers[t].run(); });
+        for (u32 t = 0; t < numThreads; t++)
+            threads[t].join();
+    }
+}  // namespace
+
+UNITTEST_SUITE_BEGIN(test_offset_allocator_mt)
+{
+    UNITTEST_FIXTURE(offset_allocator_mt)
+    {
+        UNITTEST_ALLOCATOR;
+
+        ncore::ngfx::offset_allocator_mt_t* allocator = nullptr;
+
+        UNITTEST_FIXTURE_SETUP()
+        {
+            allocator = Allocator->construct<ncore::ngfx::offset_allocator_mt_t>(Allocator, 1024 * 1024 * 256);
+            allocator->setup();
+        }
+
+        UNITTEST_FIXTURE_TEARDOWN()
+        {
+            allocator->teardown();
+            Allocator->destruct(allocator);
+        }
+
+        UNITTEST_TEST(cache_refill)
+        {
+            ncore::ngfx::offset_allocator_mt_t::cache_t* cache = Allocator->construct<ncore::ngfx::offset_allocator_mt_t::cache_t>();
+
+            // First allocation refills the cache with contiguous ranges of the size class (100 -> 104)
+            ncore::ngfx::allocation_t a = allocator->allocate(cache, 100);
+            CHECK_EQUAL(0, a.offset);
+            CHECK_EQUAL(104, allocator->allocationSize(a));
+
+            ncore::ngfx::allocation_t b = allocator->allocate(cache, 100);
+            CHECK_EQUAL(104, b.offset);
+
+            ncore::ngfx::storage_report_t report = allocator->storageReport();
+            CHECK_EQUAL(1024 * 1024 * 256 - ncore::ngfx::offset_allocator_mt_t::CACHE_REFILL * 104, report.totalFreeSpace);
+
+            // Large allocations bypass the cache
+            ncore::ngfx::allocation_t c = allocator->allocate(cache, 1024 * 1024);
+            CHECK_EQUAL(ncore::ngfx::offset_allocator_mt_t::CACHE_REFILL * 104, c.offset);
+            allocator->free(cache, c);
+
+            // Freed ranges stay in the cache and are handed out again
+            allocator->free(cache, a);
+            ncore::ngfx::allocation_t d = allocator->allocate(cache, 97);
+            CHECK_EQUAL(0, d.offset);
+
+            allocator->free(cache, b);
+            allocator->free(cache, d);
+
+            allocator->flush(cache);
+            ncore::ngfx::storage_report_t report2 = allocator->storageReport();
+            CHECK_EQUAL(1024 * 1024 * 256, report2.totalFreeSpace);
+            CHECK_EQUAL(1024 * 1024 * 256, report2.largestFreeRegion);
+
+            Allocator->destruct(cache);
+        }
+
+        UNITTEST_TEST(cache_overflow)
+        {
+            ncore::ngfx::offset_allocator_mt_t::cache_t* cache = Allocator->construct<ncore::ngfx::offset_allocator_mt_t::cache_t>();
+
+            // Free more ranges than a size class can hold, the overflow is returned to the shared allocator
+            ncore::ngfx::allocation_t allocations[32];
+            for (u32 i = 0; i < 32; i++)
+                allocations[i] = allocator->allocate(cache, 256);
+            for (u32 i = 0; i < 32; i++)
+                allocator->free(cache, allocations[i]);
+
+            ncore::ngfx::storage_report_t report = allocator->storageReport();
+            CHECK_EQUAL(1024 * 1024 * 256 - ncore::ngfx::offset_allocator_mt_t::CACHE_DEPTH * 256, report.totalFreeSpace);
+
+            allocator->flush(cache);
+            ncore::ngfx::storage_report_t report2 = allocator->storageReport();
+            CHECK_EQUAL(1024 * 1024 * 256, report2.totalFreeSpace);
+            CHECK_EQUAL(1024 * 1024 * 256, report2.largestFreeRegion);
+
+            Allocator->destruct(cache);
+        }
+
+        UNITTEST_TEST(concurrent)
+        {
+            const u32   numThreads = 4;
+            mt_worker_t workers[numThreads];
+            for (u32 t = 0; t < numThreads; t++)
+            {
+                workers[t].allocator = allocator;
+                workers[t].cache     = Allocator->construct<ncore::ngfx::offset_allocator_mt_t::cache_t>();
+                workers[t].seed      = 0x9E3779B9 * (t + 1);
+                workers[t].numOps    = 20000;
+                workers[t].numFailed = 0;
+            }
+            mt_run_workers(workers, numThreads);
+
+            // No two live allocations of all threads overlap
+            const u32                  numLive = numThreads * mt_worker_t::NUM_LIVE;
+            ncore::ngfx::allocation_t* all     = (ncore::ngfx::allocation_t*)Allocator->allocate(sizeof(ncore::ngfx::allocation_t) * numLive);
+            u32                        n       = 0;
+            for (u32 t = 0; t < numThreads; t++)
+            {
+                CHECK_EQUAL(0, workers[t].numFailed);
+                for (u32 i = 0; i < mt_worker_t::NUM_LIVE; i++)
+                {
+                    ncore::ngfx::allocation_t a = workers[t].live[i];
+                    u32                       j = n++;
+                    for (; j > 0 && all[j - 1].offset > a.offset; --j)
+                        all[j] = all[j - 1];
+                    all[j] = a;
+                }
+            }
+            for (u32 i = 1; i < n; i++)
+                CHECK_TRUE(all[i - 1].offset + allocator->allocationSize(all[i - 1]) <= all[i].offset);
+            Allocator->deallocate(all);
+
+            // Everything is back after freeing and flushing all caches
+            for (u32 t = 0; t < numThreads; t++)
+            {
+                for (u32 i = 0; i < mt_worker_t::NUM_LIVE; i++)
+                    allocator->free(workers[t].cache, workers[t].live[i]);
+                allocator->flush(workers[t].cache);
+                Allocator->destruct(workers[t].cache);
+            }
+            ncore::ngfx::storage_report_t report = allocator->storageReport();
+            CHECK_EQUAL(1024 * 1024 * 256, report.totalFreeSpace);
+            CHECK_EQUAL(1024 * 1024 * 256, report.largestFreeRegion);
+        }
+
+#ifdef OFFSET_ALLOCATOR_BENCHMARK
+        UNITTEST_TEST(contention)
+        {
+            // Throughput from 1 to N threads, each thread runs the same number of operations
+            u32 maxThreads = std::thread::hardware_concurrency();
+            maxThreads     = maxThreads < 1 ? 1 : (maxThreads > 16 ? 16 : maxThreads);
+
+            mt_worker_t workers[16];
+            for (u32 numThreads = 1; numThreads <= maxThreads; numThreads *= 2)
+            {
+                for (u32 t = 0; t < numThreads; t++)
+                {
+                    workers[t].allocator = allocator;
+                    workers[t].cache     = Allocator->construct<ncore::ngfx::offset_allocator_mt_t::cache_t>();
+                    workers[t].seed      = 0x2545F491 * (t + 1);
+                    workers[t].numOps    = 50000;
+                    workers[t].numFailed = 0;
+                }
+
+                const auto begin = std::chrono::steady_clock::now();
+                mt_run_workers(workers, numThreads);
+                const f64 seconds = std::chrono::duration<f64>(std::chrono::steady_clock::now() - begin).count();
+                printf("offset_allocator_mt: %2u threads, %6.2f Mops/s\n", numThreads, (f64)(numThreads * 50000) / seconds / 1000000.0);
+
+                for (u32 t = 0; t < numThreads; t++)
+                {
+                    CHECK_EQUAL(0, workers[t].numFailed);
+                    for (u32 i = 0; i < mt_worker_t::NUM_LIVE; i++)
+                        allocator->free(workers[t].cache, workers[t].live[i]);
+                    allocator->flush(workers[t].cache);
+                    Allocator->destruct(workers[t].cache);
+                }
+                CHECK_EQUAL(1024 * 1024 * 256, allocator->storageReport().totalFreeSpace);
+            }
+        }
+#endif
+    }
+}
+UNITTEST_SUITE_END
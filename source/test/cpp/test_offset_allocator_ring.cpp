@@ -0,0 +1,93 @@
+#include "cgfxcommon/c_offset_allocator_ring.h"
+#include "cgfxcommon/test_allocator.h"
+#include "cunittest/cunittest.h"
+
+using namespace ncore;
+
+UNITTEST_SUITE_BEGIN(test_offset_allocator_ring)
+{
+    UNITTEST_FIXTURE(offset_allocator_ring)
+    {
+        UNITTEST_ALLOCATOR;
+
+        ncore::ngfx::offset_allocator_t*      backing = nullptr;
+        ncore::ngfx::offset_allocator_ring_t* ring    = nullptr;
+
+        UNITTEST_FIXTURE_SETUP()
+        {
+            backing = Allocator->construct<ncore::ngfx::offset_allocator_t>(Allocator, 1024 * 1024, 1024);
+            backing->setup();
+            ring = Allocator->construct<ncore::ngfx::offset_allocator_ring_t>(Allocator, backing, 64 * 1024, 2);
+            ring->setup();
+        }
+
+        UNITTEST_FIXTURE_TEARDOWN()
+        {
+            ring->teardown();
+            Allocator->destruct(ring);
+            backing->teardown();
+            Allocator->destruct(backing);
+        }
+
+        UNITTEST_TEST(frames)
+        {
+            // The ring is the first range of the backing allocator
+            ncore::ngfx::allocation_t a = ring->allocate(16 * 1024);
+            CHECK_EQUAL(0, a.offset);
+            CHECK_EQUAL(ncore::ngfx::offset_allocator_ring_t::RING, a.metadata);
+            a = ring->allocate(16 * 1024);
+            CHECK_EQUAL(16 * 1024, a.offset);
+            ring->endFrame(0);
+
+            a = ring->allocate(16 * 1024);
+            CHECK_EQUAL(32 * 1024, a.offset);
+            a = ring->allocate(8 * 1024);
+            CHECK_EQUAL(48 * 1024, a.offset);
+            ring->endFrame(1);
+
+            // Retiring frame 0 frees the start of the ring. An allocation that does not fit at the end of the ring is
+            // placed at the start of the ring.
+            CHECK_EQUAL(1, ring->retire(0));
+            a = ring->allocate(16 * 1024);
+            CHECK_EQUAL(0, a.offset);
+            CHECK_EQUAL(ncore::ngfx::offset_allocator_ring_t::RING, a.metadata);
+            a = ring->allocate(16 * 1024);
+            CHECK_EQUAL(16 * 1024, a.offset);
+
+            // The ring is full up to frame 1, the allocation goes to the backing allocator
+            a = ring->allocate(16 * 1024);
+            CHECK_EQUAL(64 * 1024, a.offset);
+            CHECK_NOT_EQUAL(ncore::ngfx::offset_allocator_ring_t::RING, a.metadata);
+            CHECK_EQUAL(1, ring->overflowCount());
+            ring->endFrame(2);
+            CHECK_EQUAL(48 * 1024, ring->highWaterMark());  // 32K in the ring and 16K overflow, the skipped end of the ring does not count
+
+            // Retiring gives the overflow allocations back to the backing allocator
+            CHECK_EQUAL(2, ring->retire(2));
+            ncore::ngfx::storage_report_t report = backing->storageReport();
+            CHECK_EQUAL(1024 * 1024 - 64 * 1024, report.totalFreeSpace);
+            a = ring->allocate(24 * 1024);
+            CHECK_EQUAL(32 * 1024, a.offset);
+            CHECK_EQUAL(ncore::ngfx::offset_allocator_ring_t::RING, a.metadata);
+
+            // An allocation larger than the ring falls back without taking ring space
+            a = ring->allocate(128 * 1024);
+            CHECK_EQUAL(64 * 1024, a.offset);
+            CHECK_EQUAL(2, ring->overflowCount());
+            a = ring->allocate(8 * 1024);
+            CHECK_EQUAL(56 * 1024, a.offset);
+            CHECK_EQUAL(ncore::ngfx::offset_allocator_ring_t::RING, a.metadata);
+        }
+
+        UNITTEST_TEST(aligned)
+        {
+            ncore::ngfx::allocation_t a = ring->allocate(100);
+            CHECK_EQUAL(0, a.offset);
+            a = ring->allocate(256, 256);
+            CHECK_EQUAL(256, a.offset);
+            a = ring->allocate(4);
+            CHECK_EQUAL(512, a.offset);  // Only the padding up to the aligned offset is taken
+        }
+    }
+}
+UNITTEST_SUITE_END
@@ -0,0 +1,93 @@
+#include "cgfxcommon/c_offset_allocator_slab.h"
+#include "cgfxcommon/test_allocator.h"
+#include "cunittest/cunittest.h"
+
+using namespace ncore;
+
+UNITTEST_SUITE_BEGIN(test_offset_allocator_slab)
+{
+    UNITTEST_FIXTURE(offset_allocator_slab)
+    {
+        UNITTEST_ALLOCATOR;
+
+        ncore::ngfx::offset_allocator_t*      parent = nullptr;
+        ncore::ngfx::offset_allocator_slab_t* slab   = nullptr;
+
+        UNITTEST_FIXTURE_SETUP()
+        {
+            parent = Allocator->construct<ncore::ngfx::offset_allocator_t>(Allocator, 1024 * 1024, 1024);
+            parent->setup();
+            slab = Allocator->construct<ncore::ngfx::offset_allocator_slab_t>(Allocator, parent);
+            slab->setup();
+        }
+
+        UNITTEST_FIXTURE_TEARDOWN()
+        {
+            slab->teardown();
+            Allocator->destruct(slab);
+            parent->teardown();
+            Allocator->destruct(parent);
+        }
+
+        UNITTEST_TEST(small_blocks)
+        {
+            // A page of 16 KiB holds 256 blocks of 64 bytes, the 257th block needs a second page
+            ncore::ngfx::allocation_t allocations[300];
+            for (u32 i = 0; i < 300; i++)
+            {
+                allocations[i] = slab->allocate(50);
+                CHECK_EQUAL(64, slab->allocationSize(allocations[i]));
+            }
+            CHECK_EQUAL(0, allocations[0].offset);
+            CHECK_EQUAL(255 * 64, allocations[255].offset);
+            CHECK_EQUAL(16 * 1024, allocations[256].offset);
+            CHECK_EQUAL(2, slab->numPages());
+
+            // Only the two pages use nodes of the parent
+            ncore::ngfx::fragmentation_report_t report = parent->fragmentationReport();
+            CHECK_EQUAL(2, report.usedBlockCount);
+
+            // A different size class uses its own page
+            ncore::ngfx::allocation_t a = slab->allocate(500);
+            CHECK_EQUAL(512, slab->allocationSize(a));
+            CHECK_EQUAL(32 * 1024, a.offset);
+            CHECK_EQUAL(3, slab->numPages());
+
+            // A freed block is reused first
+            slab->free(allocations[10]);
+            allocations[10] = slab->allocate(64);
+            CHECK_EQUAL(10 * 64, allocations[10].offset);
+
+            // Empty pages go back to the parent
+            slab->free(a);
+            CHECK_EQUAL(2, slab->numPages());
+            for (u32 i = 0; i < 300; i++)
+                slab->free(allocations[i]);
+            CHECK_EQUAL(0, slab->numPages());
+
+            ncore::ngfx::storage_report_t storage = parent->storageReport();
+            CHECK_EQUAL(1024 * 1024, storage.totalFreeSpace);
+        }
+
+        UNITTEST_TEST(large_blocks)
+        {
+            // Larger requests are served by the parent
+            ncore::ngfx::allocation_t a = slab->allocate(1000);
+            CHECK_EQUAL(0, a.offset);
+            CHECK_EQUAL(1000, slab->allocationSize(a));
+            CHECK_EQUAL(0, slab->numPages());
+
+            ncore::ngfx::allocation_t b = slab->allocate(128);
+            CHECK_EQUAL(1024, b.offset);
+            CHECK_EQUAL(1, slab->numPages());
+
+            slab->free(a);
+            slab->free(b);
+            CHECK_EQUAL(0, slab->numPages());
+
+            ncore::ngfx::storage_report_t storage = parent->storageReport();
+            CHECK_EQUAL(1024 * 1024, storage.totalFreeSpace);
+        }
+    }
+}
+UNITTEST_SUITE_END
@@ -0,0 +1,159 @@
+#include "cgfxcommon/c_offset_allocator_trace.h"
+#include "cgfxcommon/c_offset_allocator_buddy.h"
+#include "cgfxcommon/test_allocator.h"
+#include "cunittest/cunittest.h"
+
+using namespace ncore;
+
+UNITTEST_SUITE_BEGIN(test_offset_allocator_trace)
+{
+    UNITTEST_FIXTURE(offset_allocator_trace)
+    {
+        UNITTEST_ALLOCATOR;
+
+        ncore::ngfx::offset_allocator_t*       allocator = nullptr;
+        ncore::ngfx::offset_allocator_trace_t* trace     = nullptr;
+
+        UNITTEST_FIXTURE_SETUP()
+        {
+            allocator = Allocator->construct<ncore::ngfx::offset_allocator_t>(Allocator, 1024 * 1024, 1024);
+            allocator->setup();
+            trace = Allocator->construct<ncore::ngfx::offset_allocator_trace_t>(Allocator, allocator, 1024);
+            trace->setup();
+        }
+
+        UNITTEST_FIXTURE_TEARDOWN()
+        {
+            trace->teardown();
+            Allocator->destruct(trace);
+            allocator->teardown();
+            Allocator->destruct(allocator);
+        }
+
+        UNITTEST_TEST(record_and_replay)
+        {
+            // 100 allocations, free every other one, leave the rest allocated
+            ncore::ngfx::allocation_t allocations[100];
+            for (u32 i = 0; i < 100; i++)
+                allocations[i] = trace->allocate(1000 + i * 10);
+            for (u32 i = 0; i < 100; i += 2)
+                trace->free(allocations[i]);
+            CHECK_EQUAL(150, trace->numEvents());
+
+            ncore::ngfx::trace_event_t const* events = trace->events();
+            CHECK_EQUAL(1010, events[1].size);
+            CHECK_EQUAL(allocations[1].offset, events[1].offset);
+            CHECK_EQUAL(ncore::ngfx::trace_event_t::FREE | 2, events[101].id);
+
+            // Save and read back
+            const u64 size   = trace->traceSize();
+            void*     buffer = Allocator->allocate((u32)size);
+            CHECK_FALSE(trace->saveTrace(buffer, size - 1));
+            CHECK_TRUE(trace->saveTrace(buffer, size));
+
+            u32                               numEvents = 0;
+            u32                               numIds    = 0;
+            ncore::ngfx::trace_event_t const* replay    = ncore::ngfx::offset_allocator_trace_t::readTrace(buffer, size, numEvents, numIds);
+            CHECK_TRUE(replay != nullptr);
+            CHECK_EQUAL(150, numEvents);
+            CHECK_EQUAL(100, numIds);
+
+            // Replay into a fresh offset allocator
+            ncore::ngfx::offset_allocator_t* target = Allocator->construct<ncore::ngfx::offset_allocator_t>(Allocator, 1024 * 1024, 1024);
+            target->setup();
+            f32                                fragmentation[8];
+            ncore::ngfx::trace_replay_report_t report;
+            const u32 numSamples = ncore::ngfx::replayTrace(target, Allocator, replay, numEvents, numIds, report, fragmentation, 8, 50);
+            CHECK_EQUAL(3, numSamples);
+            CHECK_EQUAL(100, report.numAllocs);
+            CHECK_EQUAL(50, report.numFrees);
+            CHECK_EQUAL(0, report.numFailed);
+            CHECK_EQUAL(0, report.numMoved);
+            CHECK_EQUAL(101, report.peakNodes);  // 100 used blocks plus the free tail
+            CHECK_TRUE(report.p50 <= report.p90 && report.p90 <= report.p99);
+            CHECK_TRUE(fragmentation[2] > 0.0f);
+
+            // The replay gives back everything
+            CHECK_EQUAL(1024 * 1024, target->storageReport().totalFreeSpace);
+            target->teardown();
+            Allocator->destruct(target);
+
+            // The same trace drives the buddy allocator
+            ncore::ngfx::offset_allocator_buddy_t* buddy = Allocator->construct<ncore::ngfx::offset_allocator_buddy_t>(Allocator, 1024 * 1024, 256);
+            buddy->setup();
+            ncore::ngfx::replayTrace(buddy, Allocator, replay, numEvents, numIds, report);
+            CHECK_EQUAL(100, report.numAllocs);
+            CHECK_EQUAL(0, report.numFailed);
+            CHECK_EQUAL(1024 * 1024, buddy->storageReport().totalFreeSpace);
+            buddy->teardown();
+            Allocator->destruct(buddy);
+
+            Allocator->deallocate(buffer);
+            for (u32 i = 1; i < 100; i += 2)
+                trace->free(allocations[i]);
+        }
+
+        UNITTEST_TEST(aligned)
+        {
+            ncore::ngfx::offset_allocator_t source(Allocator, 1024 * 1024, 1024);
+            source.setup();
+            ncore::ngfx::offset_allocator_trace_t recorder(Allocator, &source, 1024);
+            recorder.setup();
+
+            // Odd sizes with alignment, the alignment is part of the trace
+            ncore::ngfx::allocation_t allocations[64];
+            for (u32 i = 0; i < 64; i++)
+                allocations[i] = recorder.allocate(100 + i * 7, (i & 1) ? 4096 : 256);
+            for (u32 i = 0; i < 64; i += 3)
+                recorder.free(allocations[i]);
+            for (u32 i = 0; i < 16; i++)
+                allocations[i] = recorder.allocate(3000 + i, 1024);
+
+            ncore::ngfx::trace_event_t const* events = recorder.events();
+            CHECK_EQUAL(4096, events[1].alignment);
+            CHECK_EQUAL(256, events[2].alignment);
+
+            // Replaying into the same allocator reproduces every offset
+            ncore::ngfx::offset_allocator_t* target = Allocator->construct<ncore::ngfx::offset_allocator_t>(Allocator, 1024 * 1024, 1024);
+            target->setup();
+            ncore::ngfx::trace_replay_report_t report;
+            ncore::ngfx::replayTrace(target, Allocator, events, recorder.numEvents(), 64 + 16, report);
+            CHECK_EQUAL(64 + 16, report.numAllocs);
+            CHECK_EQUAL(0, report.numFailed);
+            CHECK_EQUAL(0, report.numMoved);
+            target->teardown();
+            Allocator->destruct(target);
+
+            recorder.teardown();
+            source.teardown();
+        }
+
+        UNITTEST_TEST(grow_capacity)
+        {
+            ncore::ngfx::offset_allocator_t source(Allocator, 1024 * 1024, 16);
+            source.setup();
+            ncore::ngfx::offset_allocator_trace_t recorder(Allocator, &source, 1024);
+            recorder.setup();
+
+            // The recorder follows the target when its capacity grows
+            ncore::ngfx::allocation_t allocations[64];
+            for (u32 i = 0; i < 14; i++)
+                allocations[i] = recorder.allocate(1000);
+            CHECK_TRUE(source.growCapacity(64));
+            for (u32 i = 14; i < 60; i++)
+                allocations[i] = recorder.allocate(1000);
+            for (u32 i = 0; i < 60; i++)
+                recorder.free(allocations[i]);
+
+            ncore::ngfx::trace_event_t const* events = recorder.events();
+            CHECK_EQUAL(120, recorder.numEvents());
+            CHECK_EQUAL(ncore::ngfx::trace_event_t::FREE | 59, events[119].id);
+            CHECK_EQUAL(allocations[59].offset, events[119].offset);
+            CHECK_EQUAL(1024 * 1024, source.storageReport().totalFreeSpace);
+
+            recorder.teardown();
+            source.teardown();
+        }
+    }
+}
+UNITTEST_SUITE_END
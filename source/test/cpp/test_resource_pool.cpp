@@ -119,6 +119,272 @@ UNITTEST_SUITE_BEGIN(resource_pool)
         }
     }
 
+    // Test the dense (packed) object pool
+    UNITTEST_FIXTURE(dense)
+    {
+        UNITTEST_ALLOCATOR;
+
+        UNITTEST_FIXTURE_SETUP() {}
+        UNITTEST_FIXTURE_TEARDOWN() {}
+
+        UNITTEST_TEST(obtain_release)
+        {
+            ngfx::nobject::array_t array;
+            array.setup(Allocator, 1024, sizeof(u32));
+            ngfx::nobject::dense_pool_t pool;
+            pool.setup(&array, Allocator);
+
+            u32 handles[8];
+            for (u32 i = 0; i < 8; i++)
+            {
+                handles[i]                         = pool.allocate();
+                *(u32*)pool.get_access(handles[i]) = 100 + i;
+            }
+            CHECK_EQUAL(8, pool.size());
+
+            // Releasing moves the last object into the hole, handles stay valid
+            pool.deallocate(handles[2]);
+            pool.deallocate(handles[5]);
+            CHECK_EQUAL(6, pool.size());
+            CHECK_FALSE(pool.is_used(handles[2]));
+            for (u32 i = 0; i < 8; i++)
+            {
+                if (i != 2 && i != 5)
+                    CHECK_EQUAL(100 + i, *(u32*)pool.get_access(handles[i]));
+            }
+
+            // The live objects are packed at the front
+            u32 sum = 0;
+            for (u32 d = 0; d < pool.size(); d++)
+            {
+                CHECK_EQUAL(*(u32*)pool.get_dense(d), *(u32*)pool.get_access(pool.get_index(d)));
+                sum += *(u32*)pool.get_dense(d);
+            }
+            CHECK_EQUAL(100 + 101 + 103 + 104 + 106 + 107, sum);
+
+            // A released handle is reused
+            u32 h = pool.allocate();
+            CHECK_EQUAL(handles[5], h);
+            CHECK_EQUAL(7, pool.size());
+
+            pool.free_all();
+            CHECK_EQUAL(0, pool.size());
+
+            pool.teardown(Allocator);
+            array.teardown(Allocator);
+        }
+    }
+
+    // Test iterating over the used objects of a pool and an inventory
+    UNITTEST_FIXTURE(iterate)
+    {
+        UNITTEST_ALLOCATOR;
+
+        UNITTEST_FIXTURE_SETUP() {}
+        UNITTEST_FIXTURE_TEARDOWN() {}
+
+        UNITTEST_TEST(pool_used)
+        {
+            ngfx::nobject::array_t array;
+            array.setup(Allocator, 1000, 4);
+            ngfx::nobject::pool_t pool;
+            pool.setup(&array, Allocator);
+
+            // Nothing to visit in an empty pool
+            ngfx::nobject::used_iterator_t iter = pool.iterate_used();
+            u32                            index;
+            CHECK_FALSE(iter.next(index));
+
+            for (u32 i = 0; i < 1000; i++)
+                pool.allocate();
+
+            // Keep a sparse set alive, spread over empty regions and the last partial word
+            u32 const live[]   = {0, 31, 32, 63, 64, 300, 301, 777, 998, 999};
+            u32 const num_live = sizeof(live) / sizeof(live[0]);
+            u32       l        = 0;
+            for (u32 i = 0; i < 1000; i++)
+            {
+                if (l < num_live && live[l] == i)
+                    l++;
+                else
+                    pool.deallocate(i);
+            }
+
+            iter  = pool.iterate_used();
+            u32 n = 0;
+            while (iter.next(index))
+            {
+                CHECK_EQUAL(live[n], index);
+                n++;
+            }
+            CHECK_EQUAL(num_live, n);
+
+            u32 sum = 0;
+            pool.for_each_used([&sum](u32 i) { sum += i; });
+            CHECK_EQUAL(0 + 31 + 32 + 63 + 64 + 300 + 301 + 777 + 998 + 999, sum);
+
+            pool.free_all();
+            iter = pool.iterate_used();
+            CHECK_FALSE(iter.next(index));
+
+            pool.teardown(Allocator);
+            array.teardown(Allocator);
+        }
+
+        UNITTEST_TEST(used_map)
+        {
+            // 40000 indices take 4 levels (1250, 40, 2 and 1 words)
+            ngfx::nobject::used_map_t map;
+            map.setup(Allocator, 40000);
+            CHECK_EQUAL(4, map.m_num_levels);
+
+            for (u32 i = 0; i < 40000; i++)
+                CHECK_EQUAL((s32)i, map.find_and_set());
+            CHECK_EQUAL(-1, map.find_and_set());
+            CHECK_EQUAL(-1, map.find_free_word());
+
+            // Freeing an index opens up the full words above it on every level
+            map.set_free(33333);
+            CHECK_EQUAL(33333 / 32, map.find_free_word());
+            CHECK_EQUAL(33333, map.find_and_set());
+            map.set_word_free(100, 0x0000FF00);
+            CHECK_EQUAL(100 * 32 + 8, map.find_and_set());
+            map.set_word_used(100, 0x0000FF00);
+            CHECK_EQUAL(-1, map.find_and_set());
+
+            map.clear();
+            CHECK_EQUAL(0, map.find_and_set());
+            map.teardown(Allocator);
+        }
+
+        UNITTEST_TEST(pool_many)
+        {
+            ngfx::nobject::array_t array;
+            array.setup(Allocator, 100, 4);
+            ngfx::nobject::pool_t pool;
+            pool.setup(&array, Allocator);
+
+            CHECK_EQUAL(0, pool.allocate());
+            CHECK_EQUAL(1, pool.allocate());
+            CHECK_EQUAL(2, pool.allocate());
+            pool.deallocate(1);
+
+            // The holes of the first word, then the start of the next word
+            u32 indices[100];
+            CHECK_EQUAL(40, pool.allocate_many(40, indices));
+            CHECK_EQUAL(1, indices[0]);
+            for (u32 i = 1; i < 40; i++)
+                CHECK_EQUAL(2 + i, indices[i]);
+
+            // Asking for more than what is left returns what is left
+            CHECK_EQUAL(100 - 42, pool.allocate_many(100, indices + 40));
+            u32 n = 0;
+            pool.for_each_used([&n](u32) { n++; });
+            CHECK_EQUAL(100, n);
+
+            pool.deallocate_many(indices, 98);
+            n = 0;
+            pool.for_each_used([&n](u32) { n++; });
+            CHECK_EQUAL(2, n);
+
+            // Freed indices are available to the single allocate again
+            CHECK_EQUAL(1, pool.allocate());
+
+            pool.teardown(Allocator);
+            array.teardown(Allocator);
+        }
+
+        UNITTEST_TEST(inventory_used)
+        {
+            ngfx::nobject::inventory_t inventory;
+            inventory.setup(Allocator, 600, 4);
+
+            inventory.allocate(5);
+            inventory.allocate(511);
+            inventory.allocate(512);
+            inventory.allocate(599);
+
+            u32 const expected[] = {5, 511, 512, 599};
+            u32       n          = 0;
+            inventory.for_each_used([&](u32 i) { CHECK_EQUAL(expected[n++], i); });
+            CHECK_EQUAL(4, n);
+
+            inventory.deallocate(511);
+            n = 0;
+            inventory.for_each_used([&n](u32) { n++; });
+            CHECK_EQUAL(3, n);
+
+            inventory.teardown(Allocator);
+        }
+    }
+
+    // Test the pools on a chunked array
+    UNITTEST_FIXTURE(chunked)
+    {
+        UNITTEST_ALLOCATOR;
+
+        UNITTEST_FIXTURE_SETUP() {}
+        UNITTEST_FIXTURE_TEARDOWN() {}
+
+        UNITTEST_TEST(pool)
+        {
+            ngfx::nobject::array_t array;
+            array.setup_chunked(Allocator, 10000, 16, 6);  // 64 items per page
+            CHECK_TRUE(array.is_chunked());
+            CHECK_EQUAL(157, array.num_pages());
+
+            ngfx::nobject::pool_t pool;
+            pool.setup(&array, Allocator);
+
+            // Only the page of the first item exists
+            u32   first   = pool.allocate();
+            u32*  first_p = (u32*)pool.get_access(first);
+            *first_p      = 0xC0FFEE;
+            CHECK_NOT_NULL(array.m_pages[0]);
+            for (u32 i = 1; i < array.num_pages(); i++)
+                CHECK_NULL(array.m_pages[i]);
+
+            // Growing into new pages does not move existing items
+            u32 indices[200];
+            CHECK_EQUAL(200, pool.allocate_many(200, indices));
+            for (u32 i = 0; i < 200; i++)
+                *(u32*)pool.get_access(indices[i]) = indices[i];
+            CHECK_NOT_NULL(array.m_pages[3]);
+            CHECK_NULL(array.m_pages[4]);
+            CHECK_EQUAL(first_p, (u32*)pool.get_access(first));
+            CHECK_EQUAL(0xC0FFEE, *first_p);
+            for (u32 i = 0; i < 200; i++)
+                CHECK_EQUAL(indices[i], *(u32*)pool.get_access(indices[i]));
+
+            pool.teardown(Allocator);
+            array.teardown(Allocator);
+        }
+
+        UNITTEST_TEST(dense_and_inventory)
+        {
+            ngfx::nobject::array_t array;
+            array.setup_chunked(Allocator, 1000, 8, 4);
+            ngfx::nobject::dense_pool_t pool;
+            pool.setup(&array, Allocator);
+
+            for (u32 i = 0; i < 20; i++)
+                *(u32*)pool.get_access(pool.allocate()) = i;
+            CHECK_NOT_NULL(array.m_pages[1]);
+            CHECK_NULL(array.m_pages[2]);
+
+            pool.teardown(Allocator);
+            array.teardown(Allocator);
+
+            ngfx::nobject::inventory_t inventory;
+            inventory.setup_chunked(Allocator, 1000, 8, 4);
+            inventory.allocate(999);
+            *(u32*)inventory.get_access(999) = 999;
+            CHECK_NOT_NULL(inventory.m_array.m_pages[62]);
+            CHECK_NULL(inventory.m_array.m_pages[0]);
+            inventory.teardown(Allocator);
+        }
+    }
+
     // Test the typed resource pool
     UNITTEST_FIXTURE(types)
     {
@@ -0,0 +1,144 @@
+#include "cgfxcommon/c_vmem_alloc.h"
+#include "cgfxcommon/c_resource_pool.h"
+#include "cgfxcommon/test_allocator.h"
+#include "cunittest/cunittest.h"
+
+using namespace ncore;
+
+UNITTEST_SUITE_BEGIN(test_vmem_alloc)
+{
+    UNITTEST_FIXTURE(vmem_alloc)
+    {
+        UNITTEST_ALLOCATOR;
+
+        UNITTEST_FIXTURE_SETUP() {}
+        UNITTEST_FIXTURE_TEARDOWN() {}
+
+#if defined(TARGET_LINUX)
+        UNITTEST_TEST(reserve_commit)
+        {
+            ngfx::vmem_alloc_t vmem(256 * 1024 * 1024);
+            CHECK_TRUE(vmem.setup());
+            CHECK_EQUAL(256 * 1024 * 1024, vmem.reserved());
+            CHECK_EQUAL(0, vmem.committed());
+
+            // Pages are committed as the allocations grow
+            ngfx::nobject::inventory_t inventory;
+            inventory.setup(&vmem, 1000000, 16);
+            CHECK_TRUE(vmem.committed() >= vmem.used());
+            CHECK_TRUE(vmem.committed() < 32 * 1024 * 1024);
+
+            inventory.allocate(999999);
+            *(u32*)inventory.get_access(999999) = 42;
+            CHECK_EQUAL(42, *(u32*)inventory.get_access(999999));
+
+            // The most recent allocation can be given back
+            const u64 used = vmem.used();
+            void*     p    = vmem.allocate(1000, 64);
+            CHECK_NOT_NULL(p);
+            CHECK_EQUAL(0, (ncore::uint_t)p & 63);
+            vmem.deallocate(p);
+            CHECK_EQUAL(used, vmem.used());
+
+            // More than what is reserved fails
+            CHECK_NULL(vmem.allocate(0x80000000));
+            CHECK_NULL(vmem.allocate(0x80000000));
+
+            inventory.teardown(&vmem);
+            vmem.teardown();
+        }
+
+        UNITTEST_TEST(commit_all)
+        {
+            // Committing the whole reservation stays within the mapping
+            ngfx::vmem_alloc_t vmem(1024 * 1024 + 4096);
+            CHECK_TRUE(vmem.setup());
+
+            const u32 size = (u32)vmem.reserved();
+            byte*     p    = (byte*)vmem.allocate(size);
+            CHECK_NOT_NULL(p);
+            CHECK_EQUAL(vmem.reserved(), vmem.committed());
+            p[0]        = 1;
+            p[size - 1] = 2;
+            CHECK_EQUAL(1, p[0]);
+            CHECK_EQUAL(2, p[size - 1]);
+            CHECK_NULL(vmem.allocate(1));
+
+            vmem.deallocate(p);
+            vmem.teardown();
+        }
+
+        UNITTEST_TEST(huge_pages)
+        {
+            ngfx::vmem_alloc_t vmem(64 * 1024 * 1024, ngfx::vmem_alloc_t::HUGE_PAGES);
+            CHECK_TRUE(vmem.setup());
+
+            // Committed in huge page steps
+            void* p = vmem.allocate(100);
+            CHECK_NOT_NULL(p);
+            CHECK_EQUAL(0, (ncore::uint_t)p & (2 * 1024 * 1024 - 1));
+            CHECK_EQUAL(2 * 1024 * 1024, vmem.committed());
+            vmem.deallocate(p);
+            vmem.teardown();
+        }
+
+        UNITTEST_TEST(trim)
+        {
+            ngfx::vmem_alloc_t vmem(64 * 1024 * 1024);
+            CHECK_TRUE(vmem.setup());
+
+            ngfx::nobject::array_t array;
+            array.setup(&vmem, 64 * 1024, 64);
+            ngfx::nobject::pool_t pool;
+            pool.setup(&array, Allocator);
+
+            u32 indices[256];
+            CHECK_EQUAL(256, pool.allocate_many(256, indices));
+            for (u32 i = 0; i < 256; i++)
+                *(u32*)pool.get_access(indices[i]) = 1000 + i;
+
+            ngfx::nobject::vmem_trim_t trim;
+            trim.setup(Allocator, &vmem, &array, pool.used_bits(), 2);
+            CHECK_TRUE(trim.m_num_pages > 0);
+
+            // Pages are only decommitted after being free for 2 frames, the pages with used items are kept
+            CHECK_EQUAL(0, trim.update(0));
+            CHECK_EQUAL(0, trim.update(1));
+            const u32 used_pages = (256 * 64 + vmem.pageSize() - 1) / vmem.pageSize() + 1;
+            CHECK_TRUE(trim.update(2) >= trim.m_num_pages - used_pages);
+            CHECK_EQUAL(0, trim.update(3));
+            for (u32 i = 0; i < 256; i++)
+                CHECK_EQUAL(1000 + i, *(u32*)pool.get_access(indices[i]));
+
+            // A decommitted page can be used again
+            u32 more[64];
+            CHECK_EQUAL(64, pool.allocate_many(64, more));
+            *(u32*)pool.get_access(more[63]) = 7;
+            CHECK_EQUAL(7, *(u32*)pool.get_access(more[63]));
+            CHECK_EQUAL(0, *(u32*)pool.get_access(more[62]));
+
+            // Only the pages of freed items become candidates again, they are decommitted 2 frames later
+            CHECK_EQUAL(0, trim.update(4));
+            for (u32 i = 0; i < 256; i++)
+            {
+                pool.deallocate(indices[i]);
+                trim.freed(indices[i]);
+            }
+            for (u32 i = 0; i < 64; i++)
+            {
+                pool.deallocate(more[i]);
+                trim.freed(more[i]);
+            }
+            CHECK_EQUAL(0, trim.update(5));
+            CHECK_TRUE(trim.update(6) >= used_pages - 2);
+            CHECK_EQUAL(0, trim.m_num_candidates);
+
+            trim.teardown(Allocator);
+            pool.teardown(Allocator);
+            array.teardown(&vmem);
+            vmem.teardown();
+        }
+#endif
+    }
+}
+UNITTEST_SUITE_END